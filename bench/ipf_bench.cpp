@@ -0,0 +1,711 @@
+// Synthetic benchmark of the IPF pipeline. Every container is generated
+// locally with IPFWriter, so no game data is needed; results are written as
+// JSON so runs from different releases can be compared.
+//
+//   ipf_bench [--json results.json] [--filter substring] [--repeats N]
+//             [--threads 1,2,4] [--work-dir dir] [--quick] [--trace trace.json]
+//   ipf_bench --conformance [--conformance-ipf real.ipf ...] [--quick]
+//
+// --conformance checks fastInflate against zlib instead of timing anything and
+// exits non-zero on any difference.
+
+#include "ipf/buffer_pool.hpp"
+#include "ipf/bulk_extract.hpp"
+#include "ipf/decompress.hpp"
+#include "ipf/decrypt.hpp"
+#include "ipf/fast_inflate.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/ipf_reader.hpp"
+#include "ipf/ipf_writer.hpp"
+#include "ipf/trace.hpp"
+#include "ipf/utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::string json_path = "ipf_bench.json";
+        std::string work_dir = "ipf_bench_work";
+        std::string trace_path;           // Chrome trace of the whole run (needs KLAIPEDA_TRACE)
+        std::string filter;               // only run benchmarks whose "name/distribution" contains this
+        size_t repeats = 5;               // timed runs per benchmark, after one warm-up
+        std::vector<size_t> thread_counts; // for full-container extraction; empty = 1, 2, 4, hardware
+        bool quick = false;               // a tenth of the data, for smoke runs
+        bool conformance = false;         // check fastInflate against zlib instead of timing
+        std::vector<std::string> conformance_files; // real containers to check entry by entry
+    };
+
+    struct BenchResult
+    {
+        std::string name;
+        std::string distribution;
+        size_t threads = 1;
+        uint64_t items = 0; // entries or blocks handled per run
+        uint64_t bytes = 0; // payload bytes handled per run
+        std::vector<double> samples;
+
+        double getBest() const { return samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end()); }
+        double getMedian() const
+        {
+            if (samples.empty())
+                return 0.0;
+            std::vector<double> sorted(samples);
+            std::sort(sorted.begin(), sorted.end());
+            return sorted[sorted.size() / 2];
+        }
+    };
+
+    // Entry sizes and type mix of one synthetic container.
+    struct Distribution
+    {
+        const char *name;
+        size_t entries;
+        uint32_t min_size;
+        uint32_t max_size;
+        unsigned stored_percent; // share of .jpg entries, written without compression
+    };
+
+    const Distribution DISTRIBUTIONS[] = {
+        {"small", 20000, 64, 4096, 5},          // ies/xml tables
+        {"mixed", 4000, 0, 256 * 1024, 25},     // a typical client container
+        {"large", 48, 1 << 20, 8 << 20, 25},    // textures, sound banks
+    };
+
+    const uint32_t KERNEL_BLOCK_SIZES[] = {4 * 1024, 64 * 1024, 1024 * 1024};
+    const size_t KERNEL_TOTAL_BYTES = 16u << 20;
+
+    // xorshift64*, fixed seed so every run generates the same containers
+    class Rng
+    {
+    public:
+        explicit Rng(uint64_t seed) : state(seed) {}
+        uint64_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ull;
+        }
+        uint32_t range(uint32_t lo, uint32_t hi) { return lo + static_cast<uint32_t>(next() % (static_cast<uint64_t>(hi - lo) + 1)); }
+
+    private:
+        uint64_t state;
+    };
+
+    // XML-like text compresses roughly like real ies/xml entries; binary is incompressible.
+    void fillPayload(Rng &rng, std::vector<uint8_t> &out, size_t size, bool text)
+    {
+        out.resize(size);
+        if (!text)
+        {
+            for (size_t i = 0; i < size; ++i)
+                out[i] = static_cast<uint8_t>(rng.next() >> 56);
+            return;
+        }
+        char line[96];
+        size_t pos = 0;
+        while (pos < size)
+        {
+            int n = std::snprintf(line, sizeof(line), "<Class ClassID=\"%u\" Name=\"item_%u\" Value=\"%u\"/>\n",
+                                  static_cast<unsigned>(rng.next() % 100000), static_cast<unsigned>(rng.next() % 5000),
+                                  static_cast<unsigned>(rng.next() % 1000));
+            size_t take = std::min<size_t>(static_cast<size_t>(n), size - pos);
+            std::memcpy(out.data() + pos, line, take);
+            pos += take;
+        }
+    }
+
+    bool selected(const BenchOptions &options, const std::string &name, const std::string &distribution)
+    {
+        return options.filter.empty() || (name + "/" + distribution).find(options.filter) != std::string::npos;
+    }
+
+    // One untimed warm-up, then options.repeats timed runs of body.
+    template <class F>
+    void measure(const BenchOptions &options, BenchResult &result, F &&body)
+    {
+        body();
+        for (size_t i = 0; i < options.repeats; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            result.samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        char buf[192];
+        double best = result.getBest();
+        std::snprintf(buf, sizeof(buf), "%-20s %-6s t=%-2zu best %.4fs  %.1f MB/s  %.0f items/s", result.name.c_str(),
+                      result.distribution.c_str(), result.threads, best,
+                      best > 0.0 ? static_cast<double>(result.bytes) / (1024.0 * 1024.0) / best : 0.0,
+                      best > 0.0 ? static_cast<double>(result.items) / best : 0.0);
+        logInfo(buf);
+    }
+
+    bool buildContainer(const Distribution &dist, size_t entries, const std::string &path, uint64_t &payloadBytes,
+                        std::string &err)
+    {
+        Rng rng(0x1f2e3d4c5b6a7988ull ^ entries);
+        IPFWriterOptions writerOptions;
+        writerOptions.container_name = "bench.ipf";
+        IPFWriter writer(writerOptions);
+        payloadBytes = 0;
+        char name[64];
+        for (size_t i = 0; i < entries; ++i)
+        {
+            bool stored = rng.range(1, 100) <= dist.stored_percent;
+            std::snprintf(name, sizeof(name), "%s/entry_%05zu.%s", stored ? "ui" : "xml", i, stored ? "jpg" : "xml");
+            std::vector<uint8_t> data;
+            fillPayload(rng, data, rng.range(dist.min_size, dist.max_size), !stored);
+            payloadBytes += data.size();
+            writer.addFile(name, std::move(data));
+        }
+        IPFWriteStats stats;
+        return writer.write(path, stats, err);
+    }
+
+    void removeTree(const std::string &dir)
+    {
+        std::vector<std::string> files;
+        listFilesRecursive(dir, "", files);
+        std::vector<std::string> dirs;
+        for (auto &f : files)
+        {
+            std::remove(f.c_str());
+            for (size_t slash = f.find_last_of('/'); slash != std::string::npos && slash > dir.size();
+                 slash = f.find_last_of('/', slash - 1))
+                dirs.push_back(f.substr(0, slash));
+        }
+        dirs.push_back(dir);
+        std::sort(dirs.begin(), dirs.end());
+        dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+        // Deepest first, so each directory is already empty when it is removed
+        std::sort(dirs.begin(), dirs.end(), [](const std::string &a, const std::string &b)
+                  { return a.size() > b.size(); });
+        for (auto &d : dirs)
+        {
+#if defined(_WIN32)
+            _rmdir(d.c_str());
+#else
+            rmdir(d.c_str());
+#endif
+        }
+    }
+
+    // decryptInplace and the inflate entry points (decompress_into_zlib has
+    // fastInflate turned off) over blocks of one size.
+    void runKernelBenchmarks(const BenchOptions &options, std::vector<BenchResult> &results)
+    {
+        size_t total = options.quick ? KERNEL_TOTAL_BYTES / 8 : KERNEL_TOTAL_BYTES;
+        for (uint32_t blockSize : KERNEL_BLOCK_SIZES)
+        {
+            std::string dist = blockSize >= (1u << 20) ? std::to_string(blockSize >> 20) + "m" : std::to_string(blockSize >> 10) + "k";
+            size_t blocks = std::max<size_t>(1, total / blockSize);
+            Rng rng(blockSize);
+
+            std::vector<uint8_t> plain;
+            fillPayload(rng, plain, blockSize, true);
+            std::vector<uint8_t> compressed;
+            std::string err;
+            if (!compressDeflate(ByteSpan(plain.data(), plain.size()), compressed, 6, err))
+            {
+                logError("compressDeflate: " + err);
+                continue;
+            }
+
+            if (selected(options, "decrypt", dist))
+            {
+                BenchResult r;
+                r.name = "decrypt";
+                r.distribution = dist;
+                r.items = blocks;
+                r.bytes = static_cast<uint64_t>(blocks) * blockSize;
+                std::vector<uint8_t> buf(plain);
+                measure(options, r, [&]()
+                        {
+                    for (size_t b = 0; b < blocks; ++b)
+                        decryptInplace(MutableByteSpan(buf.data(), buf.size())); });
+                results.push_back(r);
+            }
+
+            if (selected(options, "decompress_zlib", dist))
+            {
+                BenchResult r;
+                r.name = "decompress_zlib";
+                r.distribution = dist;
+                r.items = blocks;
+                r.bytes = static_cast<uint64_t>(blocks) * blockSize;
+                std::vector<uint8_t> out;
+                bool ok = true;
+                measure(options, r, [&]()
+                        {
+                    for (size_t b = 0; b < blocks; ++b)
+                        ok = decompressZlib(compressed, out, err) && ok; });
+                if (!ok || out != plain)
+                    logError("decompress_zlib/" + dist + ": output mismatch " + err);
+                results.push_back(r);
+            }
+
+            if (selected(options, "decompress_into_zlib", dist))
+            {
+                BenchResult r;
+                r.name = "decompress_into_zlib";
+                r.distribution = dist;
+                r.items = blocks;
+                r.bytes = static_cast<uint64_t>(blocks) * blockSize;
+                std::vector<uint8_t> out;
+                bool ok = true;
+                setFastInflateEnabled(false);
+                measure(options, r, [&]()
+                        {
+                    for (size_t b = 0; b < blocks; ++b)
+                        ok = decompressZlibInto(ByteSpan(compressed.data(), compressed.size()), out, plain.size(), err) && ok; });
+                setFastInflateEnabled(true);
+                if (!ok || out != plain)
+                    logError("decompress_into_zlib/" + dist + ": output mismatch " + err);
+                results.push_back(r);
+            }
+
+            if (selected(options, "decompress_into", dist))
+            {
+                BenchResult r;
+                r.name = "decompress_into";
+                r.distribution = dist;
+                r.items = blocks;
+                r.bytes = static_cast<uint64_t>(blocks) * blockSize;
+                std::vector<uint8_t> out;
+                bool ok = true;
+                measure(options, r, [&]()
+                        {
+                    for (size_t b = 0; b < blocks; ++b)
+                        ok = decompressZlibInto(ByteSpan(compressed.data(), compressed.size()), out, plain.size(), err) && ok; });
+                if (!ok || out != plain)
+                    logError("decompress_into/" + dist + ": output mismatch " + err);
+                results.push_back(r);
+            }
+        }
+    }
+
+    // Table parsing, one-by-one extraction and parallel extraction (mapped or batched reads) over one container.
+    void runContainerBenchmarks(const BenchOptions &options, const Distribution &dist, std::vector<BenchResult> &results)
+    {
+        const char *names[] = {"parse_root", "parse_index", "extract_single", "extract_all", "extract_batched"};
+        bool any = false;
+        for (const char *n : names)
+            any = any || selected(options, n, dist.name);
+        if (!any)
+            return;
+
+        size_t entries = options.quick ? std::max<size_t>(dist.entries / 10, 8) : dist.entries;
+        std::string path = options.work_dir + "/" + dist.name + ".ipf";
+        uint64_t payloadBytes = 0;
+        std::string err;
+        if (!buildContainer(dist, entries, path, payloadBytes, err))
+        {
+            logError("Failed to generate " + path + ": " + err);
+            return;
+        }
+
+        IPFIndex index;
+        std::vector<std::string> warnings;
+        if (!readIpfIndexFromPath(path, index, warnings))
+        {
+            logError("Failed to read back " + path);
+            return;
+        }
+
+        if (selected(options, "parse_root", dist.name))
+        {
+            BenchResult r;
+            r.name = "parse_root";
+            r.distribution = dist.name;
+            r.items = entries;
+            measure(options, r, [&]()
+                    {
+                IPFRoot root;
+                readIpfRootFromPath(path, root); });
+            results.push_back(r);
+        }
+
+        if (selected(options, "parse_index", dist.name))
+        {
+            BenchResult r;
+            r.name = "parse_index";
+            r.distribution = dist.name;
+            r.items = entries;
+            measure(options, r, [&]()
+                    {
+                IPFIndex parsed;
+                std::vector<std::string> parseWarnings;
+                readIpfIndexFromPath(path, parsed, parseWarnings); });
+            results.push_back(r);
+        }
+
+        if (selected(options, "extract_single", dist.name))
+        {
+            BenchResult r;
+            r.name = "extract_single";
+            r.distribution = dist.name;
+            r.items = entries;
+            r.bytes = payloadBytes;
+            std::vector<uint8_t> out, scratch;
+            size_t failures = 0;
+            measure(options, r, [&]()
+                    {
+                for (uint32_t row = 0; row < index.size(); ++row)
+                    if (!extractFileData(index.getEntry(row), out, scratch, err))
+                        ++failures; });
+            if (failures)
+                logError("extract_single/" + std::string(dist.name) + ": " + std::to_string(failures) + " failures");
+            results.push_back(r);
+        }
+
+        if (selected(options, "extract_all", dist.name))
+        {
+            for (size_t threads : options.thread_counts)
+            {
+                BenchResult r;
+                r.name = "extract_all";
+                r.distribution = dist.name;
+                r.threads = threads;
+                r.items = entries;
+                r.bytes = payloadBytes;
+                BulkExtractOptions extractOptions;
+                extractOptions.output_dir = options.work_dir + "/out";
+                extractOptions.thread_count = threads;
+                measure(options, r, [&]()
+                        {
+                    BulkExtractStats stats;
+                    extractAll(index, extractOptions, stats); });
+                results.push_back(r);
+            }
+            removeTree(options.work_dir + "/out");
+        }
+
+        if (selected(options, "extract_batched", dist.name))
+        {
+            for (size_t threads : options.thread_counts)
+            {
+                BenchResult r;
+                r.name = "extract_batched";
+                r.distribution = dist.name;
+                r.threads = threads;
+                r.items = entries;
+                r.bytes = payloadBytes;
+                BulkExtractOptions extractOptions;
+                extractOptions.output_dir = options.work_dir + "/out";
+                extractOptions.thread_count = threads;
+                extractOptions.batched_reads = true;
+                measure(options, r, [&]()
+                        {
+                    BulkExtractStats stats;
+                    extractAll(index, extractOptions, stats); });
+                results.push_back(r);
+            }
+            removeTree(options.work_dir + "/out");
+        }
+
+        std::remove(path.c_str());
+    }
+
+    // Raw deflate with zlib's strategies, to get streams compressDeflate never makes
+    bool deflateWith(const std::vector<uint8_t> &data, int level, int strategy, std::vector<uint8_t> &out)
+    {
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+            return false;
+        out.resize(deflateBound(&zs, static_cast<uLong>(data.size())));
+        zs.next_in = const_cast<Bytef *>(data.data());
+        zs.avail_in = static_cast<uInt>(data.size());
+        zs.next_out = out.data();
+        zs.avail_out = static_cast<uInt>(out.size());
+        int ret = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return ret == Z_STREAM_END;
+    }
+
+    struct ConformanceStats
+    {
+        uint64_t streams = 0;
+        uint64_t mismatches = 0; // fastInflate succeeded where zlib failed or decoded something else
+        uint64_t fallbacks = 0;  // fastInflate gave up on a stream that should decode
+    };
+
+    // One stream through fastInflate and through zlib alone. With expectValid
+    // the stream is known to decode to size bytes, so fastInflate must take it.
+    void checkStream(const std::string &label, ByteSpan stream, size_t size, bool expectValid, ConformanceStats &stats)
+    {
+        std::vector<uint8_t> expected;
+        std::string err;
+        setFastInflateEnabled(false);
+        bool zlibOk = decompressZlibInto(stream, expected, size, err);
+        setFastInflateEnabled(true);
+
+        std::vector<uint8_t> actual(size);
+        bool fastOk = fastInflate(stream, actual.data(), size);
+        ++stats.streams;
+        if (fastOk && (!zlibOk || actual != expected))
+        {
+            ++stats.mismatches;
+            logError(label + ": fastInflate " + (zlibOk ? "output differs from zlib" : "accepted a stream zlib rejects: " + err));
+        }
+        else if (!fastOk && zlibOk && expectValid)
+        {
+            ++stats.fallbacks;
+            logError(label + ": fastInflate failed, zlib decoded it");
+        }
+    }
+
+    // Short repeats exercise the sub-word match copies; runs the long ones.
+    void fillConformancePayload(Rng &rng, std::vector<uint8_t> &out, size_t size, unsigned kind)
+    {
+        if (kind < 2)
+        {
+            fillPayload(rng, out, size, kind == 0);
+            return;
+        }
+        out.resize(size);
+        size_t pos = 0;
+        while (pos < size)
+        {
+            if (kind == 2)
+            {
+                size_t run = std::min<size_t>(rng.range(1, 300), size - pos);
+                std::memset(out.data() + pos, static_cast<int>(rng.next() >> 56), run);
+                pos += run;
+                continue;
+            }
+            size_t period = rng.range(1, 7);
+            size_t span = std::min<size_t>(rng.range(8, 2000), size - pos);
+            for (size_t i = 0; i < span; ++i)
+                out[pos + i] = i < period ? static_cast<uint8_t>(rng.next() >> 56) : out[pos + i - period];
+            pos += span;
+        }
+    }
+
+    // Synthetic streams over every zlib level and strategy, the same streams
+    // with a wrong expected size, bit flips and truncation, then optionally
+    // every compressed entry of real containers.
+    bool runConformance(const BenchOptions &options)
+    {
+        const size_t SIZES[] = {0, 1, 7, 258, 4096, 65536, 1u << 20};
+        const int STRATEGIES[] = {Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED};
+        const char *KINDS[] = {"text", "binary", "runs", "period"};
+
+        logInfo(std::string("fastInflate variant: ") + getFastInflateImplementation());
+        ConformanceStats stats;
+        Rng rng(0x0c0ffee5);
+        std::vector<uint8_t> plain, compressed;
+        for (size_t size : SIZES)
+        {
+            if (options.quick && size > (64u << 10))
+                continue;
+            for (unsigned kind = 0; kind < 4; ++kind)
+            {
+                fillConformancePayload(rng, plain, size, kind);
+                for (int level = 0; level <= 9; ++level)
+                {
+                    for (int strategy : STRATEGIES)
+                    {
+                        char label[96];
+                        std::snprintf(label, sizeof(label), "%s/%zu level %d strategy %d", KINDS[kind], size, level, strategy);
+                        if (!deflateWith(plain, level, strategy, compressed))
+                        {
+                            logError(std::string(label) + ": deflate failed");
+                            continue;
+                        }
+                        ByteSpan stream(compressed.data(), compressed.size());
+                        checkStream(label, stream, size, true, stats);
+                        checkStream(std::string(label) + " size+1", stream, size + 1, false, stats);
+                        if (size > 0)
+                            checkStream(std::string(label) + " size-1", stream, size - 1, false, stats);
+
+                        std::vector<uint8_t> damaged(compressed);
+                        damaged[rng.next() % damaged.size()] ^= static_cast<uint8_t>(1u << (rng.next() % 8));
+                        checkStream(std::string(label) + " bit flip", ByteSpan(damaged.data(), damaged.size()), size, false, stats);
+                        checkStream(std::string(label) + " truncated", ByteSpan(compressed.data(), rng.next() % compressed.size()),
+                                    size, false, stats);
+                    }
+                }
+            }
+        }
+
+        for (const std::string &path : options.conformance_files)
+        {
+            IPFIndex index;
+            std::vector<std::string> warnings;
+            if (!readIpfIndexFromPath(path, index, warnings))
+            {
+                logError("Failed to read " + path);
+                ++stats.mismatches;
+                continue;
+            }
+            std::vector<uint8_t> raw;
+            std::string err;
+            for (uint32_t row = 0; row < index.size(); ++row)
+            {
+                IPFEntryView ent = index.getEntry(row);
+                if (ent.shouldSkipDecompression() || ent.getFileSizeCompressed() == 0)
+                    continue;
+                if (!ent.getContainer()->readBytes(ent.getFilePointer(), ent.getFileSizeCompressed(), raw, err))
+                {
+                    logError(err);
+                    continue;
+                }
+                decryptInplace(MutableByteSpan(raw.data(), raw.size()));
+                checkStream(path + ": " + ent.getDirectoryName().str(), ByteSpan(raw.data(), raw.size()), ent.getFileSizeUncompressed(),
+                            false, stats);
+            }
+        }
+
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "Conformance: %llu streams, %llu mismatches, %llu fallbacks",
+                      static_cast<unsigned long long>(stats.streams), static_cast<unsigned long long>(stats.mismatches),
+                      static_cast<unsigned long long>(stats.fallbacks));
+        logInfo(buf);
+        return stats.mismatches == 0 && stats.fallbacks == 0;
+    }
+
+    std::string jsonEscape(const std::string &s)
+    {
+        std::string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
+
+    bool writeJson(const BenchOptions &options, const std::vector<BenchResult> &results)
+    {
+        FILE *f = std::fopen(options.json_path.c_str(), "w");
+        if (!f)
+            return false;
+        std::fprintf(f, "{\n  \"benchmark\": \"ipf_bench\",\n  \"format\": 1,\n");
+        std::fprintf(f, "  \"hardware_concurrency\": %u,\n  \"repeats\": %zu,\n  \"quick\": %s,\n  \"results\": [",
+                     std::thread::hardware_concurrency(), options.repeats, options.quick ? "true" : "false");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchResult &r = results[i];
+            double best = r.getBest();
+            std::fprintf(f,
+                         "%s\n    {\"name\": \"%s\", \"distribution\": \"%s\", \"threads\": %zu, \"items\": %llu, "
+                         "\"bytes\": %llu, \"best_seconds\": %.6f, \"median_seconds\": %.6f, "
+                         "\"mb_per_second\": %.2f, \"items_per_second\": %.1f}",
+                         i ? "," : "", jsonEscape(r.name).c_str(), jsonEscape(r.distribution).c_str(), r.threads,
+                         static_cast<unsigned long long>(r.items), static_cast<unsigned long long>(r.bytes), best,
+                         r.getMedian(), best > 0.0 ? static_cast<double>(r.bytes) / (1024.0 * 1024.0) / best : 0.0,
+                         best > 0.0 ? static_cast<double>(r.items) / best : 0.0);
+        }
+        std::fprintf(f, "\n  ]\n}\n");
+        return std::fclose(f) == 0;
+    }
+
+    void parseThreadList(const std::string &list, std::vector<size_t> &out)
+    {
+        size_t pos = 0;
+        while (pos < list.size())
+        {
+            size_t comma = list.find(',', pos);
+            if (comma == std::string::npos)
+                comma = list.size();
+            if (comma > pos)
+                out.push_back(static_cast<size_t>(std::stoul(list.substr(pos, comma - pos))));
+            pos = comma + 1;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            options.json_path = argv[++i];
+        else if (arg == "--filter" && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (arg == "--repeats" && i + 1 < argc)
+            options.repeats = std::max<size_t>(1, static_cast<size_t>(std::stoul(argv[++i])));
+        else if (arg == "--threads" && i + 1 < argc)
+            parseThreadList(argv[++i], options.thread_counts);
+        else if (arg == "--work-dir" && i + 1 < argc)
+            options.work_dir = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            options.trace_path = argv[++i];
+        else if (arg == "--quick")
+            options.quick = true;
+        else if (arg == "--conformance")
+            options.conformance = true;
+        else if (arg == "--conformance-ipf" && i + 1 < argc)
+        {
+            options.conformance = true;
+            options.conformance_files.push_back(argv[++i]);
+        }
+        else
+        {
+            logError("Unknown argument: " + arg);
+            return 1;
+        }
+    }
+    if (options.conformance)
+        return runConformance(options) ? 0 : 1;
+    if (options.thread_counts.empty())
+    {
+        size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+        options.thread_counts = {1, 2, 4, hw};
+        std::sort(options.thread_counts.begin(), options.thread_counts.end());
+        options.thread_counts.erase(std::unique(options.thread_counts.begin(), options.thread_counts.end()),
+                                    options.thread_counts.end());
+    }
+    if (!createDirectories(options.work_dir))
+    {
+        logError("Failed to create " + options.work_dir);
+        return 1;
+    }
+
+    setTracingEnabled(!options.trace_path.empty());
+
+    std::vector<BenchResult> results;
+    runKernelBenchmarks(options, results);
+    for (const Distribution &dist : DISTRIBUTIONS)
+        runContainerBenchmarks(options, dist, results);
+    removeTree(options.work_dir);
+
+    if (!writeJson(options, results))
+    {
+        logError("Failed to write " + options.json_path);
+        return 1;
+    }
+    logInfo("Wrote " + std::to_string(results.size()) + " results to " + options.json_path);
+    logInfo("Buffer pool: " + getBufferPool().getStats().toString());
+
+    if (!options.trace_path.empty())
+    {
+        std::string err;
+        if (!writeChromeTrace(options.trace_path, err))
+            logWarn(err);
+        std::cout << getTraceSummary();
+    }
+    return 0;
+}
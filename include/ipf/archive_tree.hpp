@@ -0,0 +1,117 @@
+#if !defined(ARCHIVE_TREE_HPP)
+#define ARCHIVE_TREE_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/path_table.hpp"
+#include "ipf/span.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Directory tree over the paths of a PathIndex, for the viewer. Nothing is
+// built up front: a directory lists its children with PathIndex::listDirectory
+// the first time it is expanded, and the visible rows are kept as one flat
+// array, so a list clipper indexes straight into it and only lays out what is
+// on screen. Directories remember their expansion while collapsed.
+class ArchiveTree
+{
+public:
+    static const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    struct Row
+    {
+        uint32_t node;  // directory id, or NO_NODE for a file
+        uint32_t entry; // index row of a file
+        uint32_t depth; // 0 for the children of the root
+    };
+
+    // Start over with the root's children visible. Both must outlive the tree.
+    void reset(const IPFIndex *index, const PathIndex *paths);
+
+    size_t getRowCount() const { return rows.size(); }
+    const Row &getRow(size_t i) const { return rows[i]; }
+    bool isDirectory(size_t i) const { return rows[i].node != NO_NODE; }
+    bool isExpanded(size_t i) const { return isDirectory(i) && nodes[rows[i].node].expanded; }
+
+    // Last path component of row i
+    StringRef getName(size_t i) const;
+    // Files directly inside the directory on row i; 0 until it was listed
+    size_t getFileCount(size_t i) const { return isDirectory(i) ? nodes[rows[i].node].files.size() : 0; }
+
+    // Expand or collapse the directory on row i; files are left alone.
+    void toggle(size_t i);
+    void collapseAll();
+
+    // Expand every directory on the way to the file at path and return its row.
+    bool reveal(StringRef path, size_t &row);
+
+private:
+    struct Node
+    {
+        StringRef path; // with the trailing '/', empty for the root
+        StringRef name; // both point into the index arena
+        bool listed = false;
+        bool expanded = false;
+        std::vector<uint32_t> children; // node ids, in path order
+        std::vector<uint32_t> files;    // index rows, in path order
+    };
+
+    void list(uint32_t node);
+    // Rows for the visible contents of node, expanded subdirectories included
+    void appendVisible(uint32_t node, uint32_t depth, std::vector<Row> &out);
+    size_t subtreeEnd(size_t i) const;
+
+    const IPFIndex *index = nullptr;
+    const PathIndex *paths = nullptr;
+    std::vector<Node> nodes; // 0 is the root
+    std::vector<Row> rows;
+};
+
+// Case-insensitive filter over every path of a PathIndex: a substring match,
+// or a matchGlob pattern when the text has '*' or '?'. Matching runs in
+// slices from step() so a keystroke never holds up a frame. Text that extends
+// the previous filter only retests the previous matches, and recently
+// finished results are kept, so backspacing is free as well.
+class PathFilter
+{
+public:
+    void reset(const IPFIndex *index, const PathIndex *paths);
+
+    // Begin filtering for text; "" clears the filter.
+    void setText(const std::string &text);
+    const std::string &getText() const { return text; }
+    bool isActive() const { return !text.empty(); }
+
+    // Test up to budget more paths; returns true once the filter is complete.
+    bool step(size_t budget);
+    bool isDone() const { return next >= candidateCount(); }
+    float getProgress() const;
+
+    // Matches so far, in path order; grows while step runs
+    const std::vector<uint32_t> &getMatches() const { return matches; }
+
+private:
+    struct Finished
+    {
+        std::string text;
+        std::vector<uint32_t> matches;
+    };
+
+    size_t candidateCount() const { return scan_all ? paths->size() : candidates.size(); }
+    uint32_t candidate(size_t i) const { return scan_all ? paths->getSorted().begin()[i] : candidates[i]; }
+    bool isMatch(uint32_t row) const;
+
+    static const size_t MAX_FINISHED = 8;
+
+    const IPFIndex *index = nullptr;
+    const PathIndex *paths = nullptr;
+    std::string text;
+    std::string folded; // case-folded text, for substring search
+    bool glob = false;
+    bool scan_all = false; // candidates are every path, in sorted order
+    std::vector<uint32_t> candidates;
+    size_t next = 0;
+    std::vector<uint32_t> matches;
+    std::vector<Finished> finished; // most recent last
+};
+
+#endif // ARCHIVE_TREE_HPP
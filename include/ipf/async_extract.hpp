@@ -0,0 +1,132 @@
+#if !defined(ASYNC_EXTRACT_HPP)
+#define ASYNC_EXTRACT_HPP
+#include "ipf/entry_cache.hpp"
+#include "ipf/ipf_index.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+enum class ExtractPriority
+{
+    Prefetch = 0,   // speculative, dropped by cancelPrefetches
+    Background = 1, // tooling, batch jobs
+    Normal = 2,
+    Interactive = 3 // the entry the user just selected
+};
+
+// Shared flag; copies observe the same cancellation.
+class CancellationToken
+{
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { flag->store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+struct ExtractResult
+{
+    uint32_t row = 0;
+    bool ok = false;
+    bool cancelled = false;
+    SharedBytes data;
+    std::string error;
+};
+
+typedef std::function<void(const ExtractResult &)> ExtractCallback;
+
+struct ExtractionServiceOptions
+{
+    size_t thread_count = 0;       // 0 = min(4, hardware concurrency); extraction is mostly I/O bound
+    size_t prefetch_count = 4;     // neighbours queued after every Normal/Interactive request
+    size_t prefetch_behind = 1;    // of those, how many precede the entry in the container
+    bool verify_crc = false;
+};
+
+// Asynchronous extraction over an IPFIndex. Requests run on a small set of
+// workers in priority order (FIFO within a priority) and land in an
+// EntryCache, so a prefetched neighbour is a cache hit once it is requested.
+// Neighbours are entries adjacent by file_pointer in the same container,
+// which is the read order a spinning disk likes. Callbacks run on a worker
+// thread before the future becomes ready and must not throw.
+class ExtractionService
+{
+public:
+    // cache may be shared with other readers; when null the service owns one.
+    ExtractionService(const IPFIndex &index, const ExtractionServiceOptions &options = ExtractionServiceOptions(),
+                      EntryCache *cache = nullptr);
+    ~ExtractionService();
+
+    ExtractionService(const ExtractionService &) = delete;
+    ExtractionService &operator=(const ExtractionService &) = delete;
+
+    std::future<ExtractResult> submit(uint32_t row, ExtractPriority priority = ExtractPriority::Normal,
+                                      const CancellationToken &token = CancellationToken(),
+                                      const ExtractCallback &callback = nullptr);
+
+    // Queue neighbours of row at Prefetch priority, skipping cached ones and
+    // ones already queued or being decoded.
+    void prefetchNeighbours(uint32_t row, size_t ahead, size_t behind = 0);
+    // Drop every queued prefetch, e.g. when the selection moves elsewhere.
+    void cancelPrefetches();
+
+    size_t pending() const;
+    EntryCache &getCache() { return *cache; }
+
+private:
+    struct Request
+    {
+        uint32_t row;
+        ExtractPriority priority;
+        uint64_t sequence;
+        uint64_t generation; // prefetch generation it was queued in
+        CancellationToken token;
+        ExtractCallback callback;
+        std::shared_ptr<std::promise<ExtractResult>> promise; // null for prefetches
+    };
+    struct RequestOrder
+    {
+        bool operator()(const Request &a, const Request &b) const
+        {
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+            return a.sequence > b.sequence;
+        }
+    };
+
+    // With unlessPending, a row that already has a request queued or running is left alone.
+    bool push(Request &&request, bool unlessPending = false);
+    void runWorker();
+    void run(Request &request);
+    static void finish(Request &request, ExtractResult &result);
+
+    const IPFIndex &index;
+    ExtractionServiceOptions options;
+    std::unique_ptr<EntryCache> owned_cache;
+    EntryCache *cache;
+
+    // Rows sorted by (container, file_pointer) and each row's position in it
+    std::vector<uint32_t> file_order;
+    std::vector<uint32_t> file_position;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Request> queue; // heap ordered by RequestOrder
+    std::vector<uint32_t> row_requests; // per row, requests queued or running
+    uint64_t next_sequence = 0;
+    std::atomic<uint64_t> prefetch_generation{0};
+    bool stop = false;
+    std::vector<std::thread> workers;
+};
+
+#endif // ASYNC_EXTRACT_HPP
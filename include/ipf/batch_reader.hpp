@@ -0,0 +1,58 @@
+#if !defined(BATCH_READER_HPP)
+#define BATCH_READER_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Reads kept in flight by default; deep enough to keep an NVMe queue busy.
+const unsigned DEFAULT_READ_QUEUE_DEPTH = 64;
+
+struct ReadCompletion
+{
+    uint64_t tag = 0; // as passed to submit
+    bool ok = false;
+    std::string error; // set when !ok
+};
+
+class ReadBackend;
+
+// Positional reads from many files with up to queueDepth of them in flight.
+// On Linux the reads go through an io_uring (raw syscalls, no liburing);
+// where that is unavailable (old kernel, seccomp, other platforms), or once
+// the ring fails, a few threads issue blocking pread/ReadFile calls instead. Neither path touches a
+// memory mapping. Not thread-safe: one thread submits and collects.
+class BatchReader
+{
+public:
+    // allowUring = false forces the thread backend
+    explicit BatchReader(unsigned queueDepth = DEFAULT_READ_QUEUE_DEPTH, bool allowUring = true);
+    ~BatchReader();
+
+    BatchReader(const BatchReader &) = delete;
+    BatchReader &operator=(const BatchReader &) = delete;
+
+    // Open path for reading; returns its id for submit, or -1 with err set.
+    int addFile(const std::string &path, std::string &err);
+
+    // Queue a read of size bytes at offset into dst, which must stay valid until
+    // the read is collected. Returns false while queueDepth reads are pending.
+    bool submit(int file, uint64_t offset, uint8_t *dst, size_t size, uint64_t tag);
+
+    // Start everything queued and append finished reads to done, blocking until
+    // at least minComplete (capped at pending()) have finished. Collect every
+    // pending read before destroying the reader.
+    void collect(std::vector<ReadCompletion> &done, size_t minComplete);
+
+    size_t pending() const { return pending_count; } // submitted, not collected yet
+    unsigned getQueueDepth() const { return queue_depth; }
+    const char *getBackendName() const; // "io_uring" or "threads"
+
+private:
+    std::unique_ptr<ReadBackend> backend;
+    std::vector<intptr_t> files; // descriptors, or HANDLEs on Windows
+    unsigned queue_depth;
+    size_t pending_count = 0;
+};
+
+#endif // BATCH_READER_HPP
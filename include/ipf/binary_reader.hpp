@@ -1,5 +1,6 @@
 #if !defined(BINARY_READER_HPP)
 #define BINARY_READER_HPP
+#include "ipf/buffer_pool.hpp"
 #include <fstream>
 #include <string>
 #include <vector>
@@ -25,6 +26,8 @@ public:
     bool readLe(T &out); // little-endian read
 
     bool readBytes(std::vector<uint8_t> &out, size_t count);
+    bool readBytes(PooledBuffer &out, size_t count); // no zero-fill before the read
+    bool readBytes(uint8_t *dst, size_t count);
     bool seek(std::streamoff off, std::ios::seekdir dir);
     std::streampos tell();
 
@@ -0,0 +1,99 @@
+#if !defined(BUFFER_POOL_HPP)
+#define BUFFER_POOL_HPP
+#include "ipf/span.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Bytes the pool keeps for reuse before it starts freeing returned storage.
+const size_t DEFAULT_BUFFER_POOL_BUDGET = 256u << 20;
+// Smallest size class; every request is rounded up to a power of two at least this big.
+const size_t MIN_BUFFER_SIZE_CLASS = 4096;
+
+struct BufferPoolStats
+{
+    uint64_t acquires = 0;
+    uint64_t reuses = 0;      // served from a free list
+    uint64_t allocations = 0; // went to the heap
+    uint64_t cached_bytes = 0;
+
+    std::string toString() const;
+};
+
+// Recycles uninitialised byte storage in power-of-two size classes between
+// extractions and threads. Thread-safe; a buffer acquired on one thread can be
+// released on another.
+class BufferPool
+{
+public:
+    explicit BufferPool(size_t budgetBytes = DEFAULT_BUFFER_POOL_BUDGET) : budget(budgetBytes) {}
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // Storage of at least minSize bytes; capacity receives the size class actually handed out.
+    uint8_t *acquire(size_t minSize, size_t &capacity);
+    void release(uint8_t *storage, size_t capacity);
+
+    void trim(); // free everything cached
+    BufferPoolStats getStats() const;
+
+    static size_t getSizeClass(size_t size);
+
+private:
+    static const size_t CLASS_COUNT = 64;
+
+    size_t budget;
+    mutable std::mutex mutex;
+    std::vector<uint8_t *> free_lists[CLASS_COUNT];
+    BufferPoolStats stats;
+};
+
+// Process-wide pool used by PooledBuffer unless it is given another one.
+BufferPool &getBufferPool();
+
+// Growable byte buffer backed by a BufferPool. Unlike std::vector, growing
+// never zero-fills: new bytes are uninitialised, which is what every caller
+// that is about to read or inflate into the buffer wants. Storage goes back
+// to the pool when the buffer is destroyed or moves to a larger class.
+class PooledBuffer
+{
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(BufferPool &owner) : pool(&owner) {}
+    ~PooledBuffer() { release(); }
+
+    PooledBuffer(PooledBuffer &&other) noexcept;
+    PooledBuffer &operator=(PooledBuffer &&other) noexcept;
+    PooledBuffer(const PooledBuffer &) = delete;
+    PooledBuffer &operator=(const PooledBuffer &) = delete;
+
+    // Keeps the first min(size(), count) bytes.
+    void resize(size_t count);
+    // Same, but the contents are undefined afterwards, so growing never copies.
+    void resizeDiscard(size_t count);
+    void clear() { length = 0; }
+    void release();
+
+    uint8_t *data() { return storage; }
+    const uint8_t *data() const { return storage; }
+    size_t size() const { return length; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return length == 0; }
+
+    ByteSpan span() const { return ByteSpan(storage, length); }
+    MutableByteSpan mutableSpan() { return MutableByteSpan(storage, length); }
+
+private:
+    BufferPool &getPool() const { return pool ? *pool : getBufferPool(); }
+    void grow(size_t count, bool keep);
+
+    BufferPool *pool = nullptr; // nullptr = getBufferPool()
+    uint8_t *storage = nullptr;
+    size_t length = 0;
+    size_t cap = 0;
+};
+
+#endif // BUFFER_POOL_HPP
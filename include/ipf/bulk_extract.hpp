@@ -0,0 +1,68 @@
+#if !defined(BULK_EXTRACT_HPP)
+#define BULK_EXTRACT_HPP
+#include "ipf/batch_reader.hpp"
+#include "ipf/ipf_index.hpp"
+#include "ipf/path_table.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class ThreadPool;
+
+struct BulkExtractOptions
+{
+    std::string output_dir;            // files land in output_dir/<stem>/<name>
+    std::string pattern;               // glob over the logical path, empty = everything
+    size_t thread_count = 0;           // 0 = std::thread::hardware_concurrency()
+    size_t batch_bytes = 8u << 20;     // compressed bytes handed to one task
+    bool largest_first = true;         // start batches with the most uncompressed bytes first
+    uint64_t stream_threshold = 64u << 20; // entries at least this big are streamed to disk in chunks
+    bool verify_crc = false;               // check each entry against its stored crc32 while extracting
+    bool dedup = false;                    // decode identical payloads once, hard-link the other copies
+    bool batched_reads = false;            // read payloads with a BatchReader instead of the container mappings
+    unsigned read_queue_depth = DEFAULT_READ_QUEUE_DEPTH; // reads in flight with batched_reads
+    uint64_t read_ahead_bytes = 64u << 20;                // payload bytes read but not decoded yet, at most
+};
+
+struct BulkExtractStats
+{
+    uint64_t entries = 0;   // successfully written
+    uint64_t failures = 0;
+    uint64_t bytes_in = 0;  // compressed bytes read from containers
+    uint64_t bytes_out = 0; // bytes written
+    uint64_t linked = 0;    // duplicates hard-linked (or copied) instead of decoded
+    double seconds = 0.0;
+    std::vector<std::string> errors;
+
+    double getEntriesPerSecond() const;
+    double getMegabytesInPerSecond() const;
+    double getMegabytesOutPerSecond() const;
+    std::string toString() const;
+};
+
+// Order rows by file_size_uncompressed, biggest first (ties keep container order).
+void sortLargestFirst(const IPFIndex &index, std::vector<uint32_t> &rows);
+
+// parallel_for over file-table rows: consecutive rows are grouped into ranges of
+// about grainBytes uncompressed, a row bigger than that runs alone.
+void parallelForEntries(ThreadPool &pool, const IPFIndex &index, const std::vector<uint32_t> &rows,
+                        uint64_t grainBytes, const std::function<void(const IPFEntryView &)> &body);
+
+// Rows of the index whose logical path matches pattern (all rows when empty).
+std::vector<uint32_t> selectEntries(const IPFIndex &index, const std::string &pattern);
+// Same over a path index: only the pattern's literal prefix or suffix range is scanned.
+std::vector<uint32_t> selectEntries(const PathIndex &paths, const std::string &pattern);
+
+// Decrypt + inflate the selected rows on a thread pool and write them under
+// options.output_dir. Rows are sorted by (container, file_pointer) and cut into
+// contiguous batches so every container is read front to back. With
+// options.dedup only the first row of each findDuplicates group is decoded;
+// the rest are linked to its output afterwards. With options.batched_reads the
+// calling thread keeps up to read_queue_depth reads in flight in file order
+// instead, and every finished payload becomes one decode task on the pool.
+bool extractEntries(const IPFIndex &index, const std::vector<uint32_t> &rows,
+                    const BulkExtractOptions &options, BulkExtractStats &stats);
+bool extractAll(const IPFIndex &index, const BulkExtractOptions &options, BulkExtractStats &stats);
+
+#endif // BULK_EXTRACT_HPP
@@ -0,0 +1,138 @@
+#if !defined(BYTE_CURSOR_HPP)
+#define BYTE_CURSOR_HPP
+#include "ipf/span.hpp"
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+inline bool isLittleEndianHost()
+{
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// Bounds-checked little-endian reader over an in-memory buffer. The in-memory
+// counterpart of BinaryReader: every read either succeeds fully or leaves the
+// cursor untouched and returns false.
+class ByteCursor
+{
+public:
+    ByteCursor() = default;
+    explicit ByteCursor(ByteSpan bytes) : cur(bytes.begin()), end(bytes.end()) {}
+
+    size_t remaining() const { return static_cast<size_t>(end - cur); }
+
+    template <typename T>
+    bool readLe(T &out)
+    {
+        static_assert(std::is_integral<T>::value, "Type must be integral");
+        if (remaining() < sizeof(T))
+            return false;
+        typename std::make_unsigned<T>::type res = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            res |= static_cast<decltype(res)>(static_cast<decltype(res)>(cur[i]) << (8 * i));
+        out = static_cast<T>(res);
+        cur += sizeof(T);
+        return true;
+    }
+
+    // Borrow the next count bytes without copying.
+    bool readSpan(ByteSpan &out, size_t count)
+    {
+        if (remaining() < count)
+            return false;
+        out = ByteSpan(cur, count);
+        cur += count;
+        return true;
+    }
+
+    bool readString(std::string &out, size_t count)
+    {
+        ByteSpan s;
+        if (!readSpan(s, count))
+            return false;
+        out.assign(reinterpret_cast<const char *>(s.data), s.size);
+        return true;
+    }
+
+    // u32 element count followed by little-endian elements, as written by ByteWriter::writeColumn.
+    template <typename T>
+    bool readColumn(std::vector<T> &column)
+    {
+        uint32_t count = 0;
+        ByteSpan bytes;
+        const uint8_t *start = cur;
+        if (!readLe(count) || !readSpan(bytes, static_cast<size_t>(count) * sizeof(T)))
+        {
+            cur = start;
+            return false;
+        }
+        column.resize(count);
+        if (isLittleEndianHost())
+        {
+            if (count)
+                std::memcpy(column.data(), bytes.data, bytes.size);
+            return true;
+        }
+        ByteCursor elements(bytes);
+        for (T &v : column)
+            elements.readLe(v);
+        return true;
+    }
+
+private:
+    const uint8_t *cur = nullptr;
+    const uint8_t *end = nullptr;
+};
+
+// Little-endian appender, the writing counterpart of ByteCursor.
+class ByteWriter
+{
+public:
+    explicit ByteWriter(std::vector<uint8_t> &target) : out(target) {}
+
+    size_t size() const { return out.size(); }
+
+    template <typename T>
+    void writeLe(T value)
+    {
+        static_assert(std::is_integral<T>::value, "Type must be integral");
+        typename std::make_unsigned<T>::type v = static_cast<typename std::make_unsigned<T>::type>(value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+            out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    void writeBytes(const void *data, size_t count)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        out.insert(out.end(), p, p + count);
+    }
+
+    // Whole arrays go out as one copy on little-endian hosts.
+    template <typename T>
+    void writeColumn(const std::vector<T> &column)
+    {
+        writeLe<uint32_t>(static_cast<uint32_t>(column.size()));
+        if (isLittleEndianHost())
+            writeBytes(column.data(), column.size() * sizeof(T));
+        else
+            for (T v : column)
+                writeLe<T>(v);
+    }
+
+    // Overwrite a value written earlier, e.g. a length or checksum placeholder.
+    void patchLe32(size_t offset, uint32_t value)
+    {
+        for (size_t i = 0; i < 4; ++i)
+            out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+private:
+    std::vector<uint8_t> &out;
+};
+
+#endif // BYTE_CURSOR_HPP
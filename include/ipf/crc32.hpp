@@ -0,0 +1,18 @@
+#if !defined(CRC32_HPP)
+#define CRC32_HPP
+#include "ipf/span.hpp"
+#include <stdint.h>
+
+// Standard (zlib / PKZIP) CRC32 table, polynomial 0xEDB88320. Also drives the entry cipher.
+extern const uint32_t CRC32_TABLE[256];
+
+// Running CRC32, compatible with zlib's crc32(): start with 0 and feed chunks in order.
+// Uses PCLMULQDQ folding or ARMv8 CRC instructions when the CPU has them (picked once
+// at runtime) and slicing-by-8 tables otherwise.
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t size);
+inline uint32_t crc32Compute(ByteSpan data) { return crc32Update(0, data.data, data.size); }
+
+// Name of the kernel crc32Update dispatches to ("pclmul", "armv8-crc" or "slice-by-8").
+const char *getCrc32Implementation();
+
+#endif // CRC32_HPP
@@ -1,9 +1,55 @@
 #if !defined(DECOMPRESS_HPP)
 #define DECOMPRESS_HPP
+#include "ipf/span.hpp"
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 #include <stdint.h>
 
 bool decompressZlib(const std::vector<uint8_t> &in, std::vector<uint8_t> &out, std::string &err);
 
+// Inflate raw deflate data into exactly outSize bytes at out (no guessing, no
+// reallocation, no final copy). Fails with a mismatch message when the stream
+// does not decode to exactly outSize bytes. Tries fastInflate first and falls
+// back to a per-thread zlib inflate state that is reset rather than
+// re-initialised between calls.
+bool decompressZlibInto(ByteSpan in, uint8_t *out, size_t outSize, std::string &err);
+
+// Convenience: resize out to expectedSize (reusing its capacity) and inflate into it.
+bool decompressZlibInto(ByteSpan in, std::vector<uint8_t> &out, size_t expectedSize, std::string &err);
+
+// Raw deflate (no zlib header, as stored in IPF entries) of in at zlib level
+// 0-9. out is resized to the compressed size; uses a per-thread deflate state.
+bool compressDeflate(ByteSpan in, std::vector<uint8_t> &out, int level, std::string &err);
+
+struct z_stream_s;
+
+// Receives decoded output in order; return false to stop early.
+typedef std::function<bool(const uint8_t *data, size_t size)> ByteSink;
+
+// Incremental raw-deflate decoder: feed input in any number of pieces, output is
+// produced into a fixed window and handed to a sink, so memory stays bounded.
+class InflateStream
+{
+public:
+    InflateStream();
+    ~InflateStream();
+
+    InflateStream(const InflateStream &) = delete;
+    InflateStream &operator=(const InflateStream &) = delete;
+
+    bool reset(std::string &err);
+
+    // Decode `in`, flushing every filled window to sink. Sets finished once the
+    // end of the deflate stream has been reached.
+    bool write(ByteSpan in, uint8_t *window, size_t windowSize, const ByteSink &sink, bool &finished, std::string &err);
+
+    uint64_t totalOut() const;
+
+private:
+    std::unique_ptr<z_stream_s> zs;
+    bool ready = false;
+};
+
 #endif // DECOMPRESS_HPP
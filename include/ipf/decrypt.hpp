@@ -1,8 +1,36 @@
 #if !defined(DECRYPT_HPP)
 #define DECRYPT_HPP
+#include "ipf/span.hpp"
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
+// Resumable state of the IPF entry cipher. Every even byte of an entry is
+// encrypted and the keys advance on each decrypted byte, so an entry can be
+// fed through update() in chunks of any size as long as they arrive in order.
+// The keys after the password schedule are computed once per process and
+// copied on reset().
+class IPFCipher
+{
+public:
+    IPFCipher();
+
+    void reset(); // back to the start of an entry
+    void update(MutableByteSpan data);
+    void update(uint8_t *data, size_t size) { update(MutableByteSpan(data, size)); }
+
+    // Inverse of update: the keys advance on the plaintext byte, before it is masked.
+    void encrypt(MutableByteSpan data);
+
+    uint64_t getPosition() const { return position; }
+
+private:
+    uint32_t keys[3];
+    uint64_t position = 0; // bytes consumed so far in this entry
+};
+
 void decryptInplace(std::vector<uint8_t> &data);
+void decryptInplace(MutableByteSpan data);
+void encryptInplace(MutableByteSpan data);
 
 #endif // DECRYPT_HPP
@@ -0,0 +1,37 @@
+#if !defined(DEDUP_HPP)
+#define DEDUP_HPP
+#include "ipf/ipf_index.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Entries whose stored bytes are identical decode to identical files, so a
+// dump only has to decode one of them. Candidates are grouped on the table
+// record (crc32, both sizes and whether the entry is stored or encoded) and
+// then confirmed by comparing the stored bytes, which costs a read but no
+// decryption or inflate.
+struct DedupGroup
+{
+    std::vector<uint32_t> rows; // rows[0] is the copy that gets decoded
+};
+
+struct DedupReport
+{
+    std::vector<DedupGroup> groups;   // only groups with at least two rows
+    uint64_t candidate_entries = 0;   // rows considered (empty entries are skipped)
+    uint64_t duplicate_entries = 0;   // rows that are not the first of their group
+    uint64_t saved_bytes_in = 0;      // stored bytes the duplicates would have read
+    uint64_t saved_bytes_out = 0;     // decoded bytes the duplicates would have produced
+    uint64_t false_matches = 0;       // rows whose bytes differed from the first row of their key
+    double seconds = 0.0;
+
+    std::string toString() const;
+};
+
+// Group the given rows of index. With confirm the stored bytes of every
+// candidate are compared against the group's first row; without it the
+// table record alone decides, which is free but trusts a 32-bit CRC.
+void findDuplicates(const IPFIndex &index, const std::vector<uint32_t> &rows, DedupReport &report,
+                    bool confirm = true);
+
+#endif // DEDUP_HPP
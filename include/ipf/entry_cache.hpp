@@ -0,0 +1,94 @@
+#if !defined(ENTRY_CACHE_HPP)
+#define ENTRY_CACHE_HPP
+#include "ipf/ipf_index.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// Decompressed payload shared between the cache and every reader holding it.
+typedef std::shared_ptr<const std::vector<uint8_t>> SharedBytes;
+
+static const size_t DEFAULT_ENTRY_CACHE_BUDGET = 256 * 1024 * 1024;
+
+struct EntryCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t rejected = 0; // payloads larger than the whole budget, handed out uncached
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+
+    double getHitRate() const;
+    std::string toString() const;
+};
+
+// Thread-safe LRU cache of decompressed entries keyed by (container, file_pointer).
+// Hits hand out the cached buffer itself; an evicted buffer stays alive for as
+// long as a reader still holds it. Extraction on a miss runs outside the lock,
+// so two threads missing the same entry at once may both extract it.
+class EntryCache
+{
+public:
+    explicit EntryCache(size_t budgetBytes = DEFAULT_ENTRY_CACHE_BUDGET) : budget(budgetBytes) {}
+
+    EntryCache(const EntryCache &) = delete;
+    EntryCache &operator=(const EntryCache &) = delete;
+
+    // Cached payload of ent, extracted and inserted on a miss.
+    bool get(const IPFEntryView &ent, SharedBytes &out, std::string &err, bool verifyCrc = false);
+
+    bool lookup(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer, SharedBytes &out);
+    // Presence check that leaves the LRU order and the counters alone.
+    bool contains(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer) const;
+    // Returns the buffer now cached under the key, which is an earlier one if another thread won.
+    SharedBytes insert(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer, SharedBytes data);
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const;
+    void clear();
+    EntryCacheStats getStats() const;
+
+private:
+    struct Key
+    {
+        const IPFContainer *container;
+        uint32_t file_pointer;
+
+        bool operator==(const Key &o) const { return container == o.container && file_pointer == o.file_pointer; }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key &k) const
+        {
+            return std::hash<const void *>()(k.container) ^ (static_cast<size_t>(k.file_pointer) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+    struct Node
+    {
+        Key key;
+        std::shared_ptr<IPFContainer> container; // keeps the key's pointer from being reused
+        SharedBytes data;
+        size_t charge;
+    };
+
+    static size_t chargeOf(const std::vector<uint8_t> &data) { return data.capacity() + sizeof(Node) + 32; }
+    void evictLocked();
+
+    mutable std::mutex mutex;
+    std::list<Node> lru; // most recently used first
+    std::unordered_map<Key, std::list<Node>::iterator, KeyHash> map;
+    size_t budget;
+    size_t used = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t rejected = 0;
+};
+
+#endif // ENTRY_CACHE_HPP
@@ -0,0 +1,25 @@
+#if !defined(ENTRY_STREAM_HPP)
+#define ENTRY_STREAM_HPP
+#include "ipf/decompress.hpp"
+#include "ipf/ipf_index.hpp"
+#include "ipf/ipf_types.hpp"
+#include <string>
+#include <stdint.h>
+
+static const size_t DEFAULT_STREAM_CHUNK_SIZE = 256 * 1024;
+
+// Chunked extraction: reads chunkSize bytes at a time, decrypts them with a
+// resumable cipher, inflates them and pushes the output to sink in order.
+// Peak memory is two chunk buffers regardless of the entry size. With verifyCrc
+// the stored bytes are checked as they stream past; a mismatch is reported when
+// the call returns, after the output has already been handed to sink.
+bool extractFileStream(const IPFContainer &container, const IPFFileTable &ent, const ByteSink &sink,
+                       std::string &err, size_t chunkSize = DEFAULT_STREAM_CHUNK_SIZE, bool verifyCrc = false);
+bool extractFileStream(const IPFEntryView &ent, const ByteSink &sink,
+                       std::string &err, size_t chunkSize = DEFAULT_STREAM_CHUNK_SIZE, bool verifyCrc = false);
+
+// Stream one entry straight into a file on disk.
+bool extractFileToPath(const IPFEntryView &ent, const std::string &outPath, std::string &err,
+                       size_t chunkSize = DEFAULT_STREAM_CHUNK_SIZE, bool verifyCrc = false);
+
+#endif // ENTRY_STREAM_HPP
@@ -0,0 +1,25 @@
+#if !defined(FAST_INFLATE_HPP)
+#define FAST_INFLATE_HPP
+#include "ipf/span.hpp"
+#include <stdint.h>
+
+// Raw deflate decoder for the case every IPF entry is in: the whole input is in
+// memory and the inflated size is known, so there is no window, no streaming
+// state and no output growth. Uses a 64-bit bit buffer refilled a word at a
+// time, single-lookup Huffman tables with subtables for long codes, and match
+// copies of 8/16/32 bytes (SSE2 or AVX2+BMI2 on x86, NEON on arm64, picked
+// once at runtime).
+//
+// Returns false for corrupt or truncated input and for streams that do not
+// decode to exactly outSize bytes; the caller falls back to zlib, which then
+// produces the error message.
+bool fastInflate(ByteSpan in, uint8_t *out, size_t outSize);
+
+// Name of the variant fastInflate dispatches to ("avx2", "sse2", "neon" or "generic").
+const char *getFastInflateImplementation();
+
+// decompressZlibInto tries fastInflate first while this is on (the default).
+void setFastInflateEnabled(bool enabled);
+bool isFastInflateEnabled();
+
+#endif // FAST_INFLATE_HPP
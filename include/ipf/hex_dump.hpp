@@ -0,0 +1,68 @@
+#if !defined(HEX_DUMP_HPP)
+#define HEX_DUMP_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/span.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+const size_t HEX_BYTES_PER_LINE = 16;
+
+// Formats the classic dump line "OFFSET  XX XX .. XX  ascii" with lookup
+// tables straight into a caller buffer; no streams, no per-byte formatting.
+// Lines are independent, so a viewer can render just the rows it shows.
+class HexFormatter
+{
+public:
+    // totalSize is the largest offset that will be shown; past 4 GB the offset
+    // column widens from 8 to 16 digits so every line keeps the same layout.
+    explicit HexFormatter(uint64_t totalSize = 0);
+
+    // Longest line, including the trailing '\n'
+    size_t getLineLength() const { return line_length; }
+    static uint64_t getLineCount(uint64_t size) { return (size + HEX_BYTES_PER_LINE - 1) / HEX_BYTES_PER_LINE; }
+
+    // Write one line for count (at most HEX_BYTES_PER_LINE) bytes labelled
+    // offset; out must hold getLineLength() chars. Returns the chars written.
+    size_t formatLine(uint64_t offset, const uint8_t *bytes, size_t count, char *out) const;
+
+    // Append lineCount lines of data starting at line firstLine, labelled as if
+    // data began at baseOffset (a window read from the middle of an entry).
+    void formatLines(ByteSpan data, uint64_t baseOffset, uint64_t firstLine, size_t lineCount, std::string &out) const;
+
+private:
+    unsigned offset_bytes; // 4 or 8
+    size_t line_length;
+};
+
+// Bulk dump into a FILE: bytes arrive in pieces of any size (e.g. from
+// extractFileStream) and leave in large fwrite calls.
+class HexDumpWriter
+{
+public:
+    HexDumpWriter(FILE *out, uint64_t totalSize);
+
+    bool write(const uint8_t *data, size_t size);
+    bool finish(); // writes the last partial line and flushes the buffer
+
+private:
+    bool appendLine(const uint8_t *bytes, size_t count);
+    bool flush();
+
+    HexFormatter formatter;
+    FILE *file;
+    std::vector<char> buffer;
+    size_t used = 0;
+    uint8_t pending[HEX_BYTES_PER_LINE];
+    size_t pending_count = 0;
+    uint64_t offset = 0;
+    bool failed = false;
+};
+
+bool writeHexDump(ByteSpan data, FILE *out);
+
+// Dump an entry into a text file, streaming it so the whole entry is never in memory.
+bool writeHexDumpToPath(const IPFEntryView &ent, const std::string &path, std::string &err);
+
+#endif // HEX_DUMP_HPP
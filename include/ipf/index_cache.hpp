@@ -0,0 +1,25 @@
+#if !defined(INDEX_CACHE_HPP)
+#define INDEX_CACHE_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/path_table.hpp"
+#include "ipf/utils.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+const uint32_t INDEX_CACHE_MAGIC = 0x5844494B; // "KIDX"
+// Bump whenever IPFIndex, PathIndex or FileStamp change their serialized layout.
+const uint32_t INDEX_CACHE_VERSION = 3;
+
+// On-disk snapshot of a mounted file system: every container header and parsed
+// table, the merged path index and the stamp each container had when it was
+// parsed (one per container id). Loading is a single file map plus column copies.
+//
+// Layout: magic u32, version u32, body size u64, body crc32 u32, then the body:
+// IPFIndex image, container stamps, PathIndex image.
+bool writeIndexCache(const std::string &path, const IPFIndex &index, const PathIndex &paths,
+                     const std::vector<FileStamp> &stamps, std::string &err);
+bool readIndexCache(const std::string &path, IPFIndex &index, PathIndex &paths,
+                    std::vector<FileStamp> &stamps, std::string &err);
+
+#endif // INDEX_CACHE_HPP
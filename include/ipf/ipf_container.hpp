@@ -0,0 +1,61 @@
+#if !defined(IPF_CONTAINER_HPP)
+#define IPF_CONTAINER_HPP
+#include "ipf/binary_reader.hpp"
+#include "ipf/mapped_file.hpp"
+#include "ipf/span.hpp"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// One opened .ipf file. The whole container is memory-mapped once and entries are
+// served as read-only spans; if mapping fails the BinaryReader stream is used instead.
+class IPFContainer
+{
+public:
+    IPFContainer() = default;
+    explicit IPFContainer(const std::string &path);
+
+    IPFContainer(const IPFContainer &) = delete;
+    IPFContainer &operator=(const IPFContainer &) = delete;
+
+    bool open(const std::string &path);
+    // Remember path and open it on first use. Lets a cached index hand out
+    // containers without touching every .ipf at startup.
+    void openDeferred(const std::string &path);
+
+    bool ok() const { return ensureOpen(); }
+    bool isMapped() const { return ensureOpen() && mapping.isOpen(); }
+
+    uint64_t size() const { return ensureOpen() ? file_size : 0; }
+    const std::string &path() const { return file_path; }
+    const std::string &lastError() const { return last_error; }
+
+    // Zero-copy view of [offset, offset + count). Only available when mapped.
+    bool getSpan(uint64_t offset, size_t count, ByteSpan &out) const;
+
+    // POSIX descriptor of the mapped file for copy_file_range/sendfile, -1 when
+    // there is none (Windows, or the stream fallback).
+    int getFileDescriptor() const;
+
+    // Copy [offset, offset + count) into dst. Works for both backends and is thread-safe.
+    bool readBytes(uint64_t offset, uint8_t *dst, size_t count, std::string &err) const;
+    bool readBytes(uint64_t offset, size_t count, std::vector<uint8_t> &out, std::string &err) const;
+    bool readBytes(uint64_t offset, size_t count, PooledBuffer &out, std::string &err) const;
+
+private:
+    bool ensureOpen() const;
+    bool inRange(uint64_t offset, size_t count) const;
+
+    MappedFile mapping;
+    mutable BinaryReader fallback;
+    mutable std::mutex fallback_mutex;
+    std::string file_path;
+    std::string last_error;
+    uint64_t file_size = 0;
+    bool is_open = false;
+    bool deferred = false;
+    mutable std::once_flag deferred_once;
+};
+
+#endif // IPF_CONTAINER_HPP
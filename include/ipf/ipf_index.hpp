@@ -0,0 +1,115 @@
+#if !defined(IPF_INDEX_HPP)
+#define IPF_INDEX_HPP
+#include "ipf/byte_cursor.hpp"
+#include "ipf/ipf_types.hpp"
+#include "ipf/span.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class IPFIndex;
+
+struct IPFContainerInfo
+{
+    std::string path; // full path to container .ipf
+    IPFHeader header;
+    std::shared_ptr<IPFContainer> container;
+};
+
+// Lightweight handle to one row of an IPFIndex. Exposes every field of
+// IPFFileTable without owning any strings; valid while the index is alive
+// and not modified.
+class IPFEntryView
+{
+public:
+    IPFEntryView() = default;
+    IPFEntryView(const IPFIndex *index, uint32_t row) : owner(index), row_id(row) {}
+
+    bool isValid() const { return owner != nullptr; }
+    uint32_t getRow() const { return row_id; }
+    uint32_t getContainerId() const;
+
+    uint16_t getDirectoryNameLength() const;
+    uint32_t getCrc32() const;
+    uint32_t getFileSizeCompressed() const;
+    uint32_t getFileSizeUncompressed() const;
+    uint32_t getFilePointer() const;
+    uint16_t getContainerNameLength() const;
+
+    StringRef getContainerName() const;
+    StringRef getDirectoryName() const;    // "<container stem>/<name>", same as IPFFileTable::directory_name
+    StringRef getRawDirectoryName() const; // name as stored in the file table
+    const std::string &getFilePath() const;
+    const std::shared_ptr<IPFContainer> &getContainer() const;
+
+    bool shouldSkipDecompression() const;
+    IPFFileTable toFileTable() const;
+
+private:
+    const IPFIndex *owner = nullptr;
+    uint32_t row_id = 0;
+};
+
+// Structure-of-arrays file table for any number of containers. Numeric fields
+// live in parallel arrays, names in one string arena addressed by offset and
+// length, container names are interned and each row stores a container id
+// instead of the container path.
+class IPFIndex
+{
+public:
+    uint32_t addContainer(const std::string &path, const IPFHeader &header, const std::shared_ptr<IPFContainer> &container);
+    uint32_t addRoot(const std::string &path, const IPFRoot &root);
+
+    // Append every container and row of other; returns the id other's container 0 got here.
+    uint32_t appendIndex(const IPFIndex &other);
+
+    // Append a row for a container previously returned by addContainer.
+    uint32_t appendEntry(uint32_t containerId, uint32_t crc32, uint32_t sizeCompressed, uint32_t sizeUncompressed,
+                         uint32_t filePointer, StringRef containerName, StringRef directoryName);
+
+    void reserve(size_t entries, size_t arenaBytes);
+    void clear();
+
+    // Flat image of every container header, column and the arena, used by the
+    // on-disk index cache. Container handles are not part of it: deserialize
+    // leaves them empty until setContainer is called.
+    void serialize(ByteWriter &out) const;
+    bool deserialize(ByteCursor &in, std::string &err);
+    void setContainer(uint32_t containerId, const std::shared_ptr<IPFContainer> &container);
+
+    size_t size() const { return crc_column.size(); }
+    bool empty() const { return crc_column.empty(); }
+    size_t containerCount() const { return containers.size(); }
+    size_t arenaSize() const { return arena.size(); }
+
+    IPFEntryView getEntry(uint32_t row) const { return IPFEntryView(this, row); }
+    const IPFContainerInfo &getContainerInfo(uint32_t containerId) const { return containers[containerId]; }
+
+private:
+    friend class IPFEntryView;
+
+    uint32_t internName(StringRef containerName);
+
+    // per-row columns
+    std::vector<uint32_t> crc_column;
+    std::vector<uint32_t> size_compressed_column;
+    std::vector<uint32_t> size_uncompressed_column;
+    std::vector<uint32_t> file_pointer_column;
+    std::vector<uint32_t> container_column;
+    std::vector<uint32_t> name_column;        // interned container_name id
+    std::vector<uint32_t> path_offset_column; // into arena
+    std::vector<uint32_t> path_length_column;
+
+    // interned container names ("xml.ipf"), stored in the arena as well
+    std::vector<uint32_t> name_offsets;
+    std::vector<uint16_t> name_lengths;
+    std::vector<uint16_t> name_stem_lengths;
+    std::unordered_map<std::string, uint32_t> name_lookup;
+
+    std::string arena;
+    std::vector<IPFContainerInfo> containers;
+};
+
+#endif // IPF_INDEX_HPP
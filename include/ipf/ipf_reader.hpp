@@ -1,9 +1,32 @@
 #if !defined(IPF_READER_HPP)
 #define IPF_READER_HPP
+#include "ipf/buffer_pool.hpp"
+#include "ipf/ipf_index.hpp"
 #include "ipf/ipf_types.hpp"
 #include <string>
 
 bool readIpfRootFromPath(const std::string &path, IPFRoot &out);
+
+// Parse one container straight into a compact index (no per-entry strings).
+bool readIpfIndexFromPath(const std::string &path, IPFIndex &index, std::vector<std::string> &warnings,
+                          uint32_t *containerId = nullptr);
+// Read only the 24-byte header at the end of a container.
+bool readIpfHeaderFromPath(const std::string &path, IPFHeader &header, std::string &err);
+
 bool extractFileData(const IPFFileTable &ent, std::vector<uint8_t> &out, std::string &err);
+bool extractFileData(const IPFContainer &container, const IPFFileTable &ent, std::vector<uint8_t> &out, std::string &err);
+bool extractFileData(const IPFEntryView &ent, std::vector<uint8_t> &out, std::string &err);
+// Same, reusing `scratch` for the compressed bytes so callers in a loop keep their buffers.
+// With verifyCrc the stored bytes are checked against the file table crc32 first.
+bool extractFileData(const IPFEntryView &ent, std::vector<uint8_t> &out, std::vector<uint8_t> &scratch, std::string &err,
+                     bool verifyCrc = false);
+// Pooled variant for loops that only look at the bytes before the next entry:
+// neither buffer is zero-filled and both go back to the pool when destroyed.
+bool extractFileData(const IPFEntryView &ent, PooledBuffer &out, PooledBuffer &scratch, std::string &err,
+                     bool verifyCrc = false);
+// For callers that did the read themselves: `stored` holds the entry's bytes as
+// they are in the container and is decrypted in place; out receives the file.
+bool decodeFileData(const IPFEntryView &ent, MutableByteSpan stored, PooledBuffer &out, std::string &err,
+                    bool verifyCrc = false);
 
 #endif // IPF_READER_HPP
@@ -5,6 +5,9 @@
 #include <vector>
 #include <cstdint>
 #include <map>
+#include <memory>
+
+class IPFContainer;
 
 static const uint32_t MAGIC_NUMBER = 0x06054B50;
 static const int HEADER_LOCATION = -24;
@@ -33,13 +36,19 @@ struct IPFFileTable
     std::string directory_name; // from raw bytes
     std::string file_path;      // full path to container .ipf
 
+    std::shared_ptr<IPFContainer> container; // shared mapping of file_path (may be null)
+
     bool shouldSkipDecompression() const;
     bool extractFileData(std::vector<uint8_t> &out, std::string &err);
 };
 
+// True for entries stored raw in the container (.fsb, .jpg, .mp3): no cipher, no deflate.
+bool isStoredFileName(const char *name, size_t length);
+
 struct IPFRoot
 {
     IPFHeader header;
+    std::shared_ptr<IPFContainer> container;
     std::vector<IPFFileTable> file_table;
     std::vector<std::string> warnings;
 };
@@ -0,0 +1,68 @@
+#if !defined(IPF_VFS_HPP)
+#define IPF_VFS_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/path_table.hpp"
+#include "ipf/utils.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Every .ipf of a client data directory overlaid into one namespace. Containers
+// are applied in patch order (header new_version, then version_to_patch, then
+// path) and a later container replaces earlier entries with the same logical
+// path. Lookups are case-insensitive: hash probes for exact paths,
+// binary searches for prefixes and directory listings.
+class IPFFileSystem
+{
+public:
+    // Scan dataDir recursively for *.ipf and mount all of them.
+    bool mount(const std::string &dataDir, std::vector<std::string> &warnings, size_t threadCount = 0);
+    // Mount an explicit list of containers. Unreadable ones are skipped with a warning.
+    bool mountFiles(const std::vector<std::string> &paths, std::vector<std::string> &warnings, size_t threadCount = 0);
+    // Like mount, but start from the index cache at cachePath. Containers whose
+    // size and mtime still match are taken from the cache and opened lazily;
+    // only new or changed ones are parsed. The cache is rewritten when anything
+    // changed, so an untouched client mounts from one file map.
+    bool mountCached(const std::string &dataDir, const std::string &cachePath, std::vector<std::string> &warnings,
+                     size_t threadCount = 0);
+    bool saveCache(const std::string &cachePath, std::string &err) const;
+    void clear();
+
+    const IPFIndex &getIndex() const { return index; }
+
+    // Number of distinct logical paths after overlaying.
+    size_t size() const { return path_index.size(); }
+
+    // Winning entry for a logical path such as "xml/item.xml".
+    bool find(StringRef path, IPFEntryView &out) const;
+
+    // Prefix, directory and glob queries over the winning entries.
+    const PathIndex &getPaths() const { return path_index; }
+
+    // Rows that won the overlay, sorted by row id.
+    std::vector<uint32_t> getVisibleRows() const;
+
+    // Highest new_version of any mounted container, i.e. the client version.
+    uint32_t getVersion() const;
+
+    // Container ids in the order they were applied (lowest priority first).
+    const std::vector<uint32_t> &getContainerOrder() const { return container_order; }
+
+private:
+    // One single-container IPFIndex per path; ok[i] is 0 for unreadable paths.
+    void parseContainers(const std::vector<std::string> &paths, std::vector<IPFIndex> &parsed, std::vector<char> &ok,
+                         std::vector<std::string> &warnings, size_t threadCount);
+    // Merge single-container indexes in patch order and rebuild the path table.
+    void applyInPatchOrder(std::vector<IPFIndex> &parts, const std::vector<FileStamp> &stamps);
+    void rebuildLookup();
+
+    IPFIndex index;
+    PathIndex path_index;
+    std::vector<uint32_t> container_order;
+    std::vector<FileStamp> container_stamps; // by container id
+};
+
+// Patch order used when overlaying containers.
+bool isAppliedBefore(const IPFContainerInfo &a, const IPFContainerInfo &b);
+
+#endif // IPF_VFS_HPP
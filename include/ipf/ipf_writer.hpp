@@ -0,0 +1,79 @@
+#if !defined(IPF_WRITER_HPP)
+#define IPF_WRITER_HPP
+#include "ipf/ipf_index.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct IPFWriterOptions
+{
+    std::string container_name;   // written into every record; defaults to the output file name
+    uint32_t version_to_patch = 0;
+    uint32_t new_version = 0;
+    int compression_level = 6;    // zlib level for new entries
+    size_t thread_count = 0;      // 0 = hardware concurrency
+    size_t max_in_flight = 0;     // encoded entries held ahead of the writer; 0 = 4 per thread
+};
+
+struct IPFWriteStats
+{
+    uint64_t entries = 0;
+    uint64_t encoded = 0; // compressed (or stored) from new content
+    uint64_t copied = 0;  // taken verbatim from an existing container
+    uint64_t bytes_in = 0;  // uncompressed size of all entries
+    uint64_t bytes_out = 0; // container size
+    double seconds = 0.0;
+
+    std::string toString() const;
+};
+
+// Builds one .ipf. New entries are deflated and encrypted on a thread pool
+// (stored types are written as-is) while the calling thread appends finished
+// payloads to the file in the order they were added, so output is identical
+// for any thread count. Entries copied from an existing container keep their
+// stored bytes and CRC and are never decoded.
+class IPFWriter
+{
+public:
+    explicit IPFWriter(const IPFWriterOptions &options = IPFWriterOptions()) : options(options) {}
+
+    // name is the path inside the container, without the container stem ("item.xml", not "xml/item.xml").
+    void addFile(const std::string &name, std::vector<uint8_t> &&data);
+    // Contents are read from sourcePath by a worker when the entry is encoded.
+    void addFileFromPath(const std::string &name, const std::string &sourcePath);
+    // Verbatim copy, optionally under a different name. The record keeps the
+    // source's container name, so one file can carry entries of several
+    // logical containers, as patch containers do.
+    void addCopy(const IPFEntryView &source);
+    void addCopy(const IPFEntryView &source, const std::string &name);
+
+    size_t size() const { return entries.size(); }
+
+    // Write everything to outPath (through a temporary, renamed on success).
+    bool write(const std::string &outPath, IPFWriteStats &stats, std::string &err);
+
+private:
+    struct PendingEntry
+    {
+        std::string name;
+        std::string container_name; // empty = IPFWriterOptions::container_name
+        std::vector<uint8_t> data;
+        std::string source_path;
+        IPFEntryView source; // valid for verbatim copies
+    };
+
+    IPFWriterOptions options;
+    std::vector<PendingEntry> entries;
+};
+
+// Incremental repack of the container at inPath into outPath. Entries named in
+// changes get the new content, names in changes that do not exist yet are
+// appended, names in removed are dropped, and every other entry is copied
+// verbatim. Names are the in-container names as for IPFWriter. Header versions
+// are kept unless options set them.
+bool repackContainer(const std::string &inPath, const std::string &outPath,
+                     std::map<std::string, std::vector<uint8_t>> &&changes, const std::vector<std::string> &removed,
+                     IPFWriterOptions options, IPFWriteStats &stats, std::string &err);
+
+#endif // IPF_WRITER_HPP
@@ -0,0 +1,46 @@
+#if !defined(MAPPED_FILE_HPP)
+#define MAPPED_FILE_HPP
+#include "ipf/span.hpp"
+#include <string>
+#include <stdint.h>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, file mapping on Windows).
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return is_open; }
+    const uint8_t *data() const { return map_data; }
+    uint64_t size() const { return map_size; }
+    ByteSpan span() const { return ByteSpan(map_data, static_cast<size_t>(map_size)); }
+
+    const std::string &lastError() const { return last_error; }
+
+#if !defined(_WIN32)
+    // Descriptor the mapping was made from, kept open for kernel-side copies.
+    int getFileDescriptor() const { return file_descriptor; }
+#endif
+
+private:
+    const uint8_t *map_data = nullptr;
+    uint64_t map_size = 0;
+    bool is_open = false;
+    std::string last_error;
+#if defined(_WIN32)
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+};
+
+#endif // MAPPED_FILE_HPP
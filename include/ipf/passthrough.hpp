@@ -0,0 +1,22 @@
+#if !defined(PASSTHROUGH_HPP)
+#define PASSTHROUGH_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/span.hpp"
+#include <string>
+#include <stdint.h>
+
+// Stored entries (.fsb/.jpg/.mp3, see isStoredFileName) are neither encrypted
+// nor compressed, so their bytes in the container are the file itself.
+
+// Zero-copy view of a stored entry inside the container mapping. Fails for
+// entries that need decoding and for containers that are not mapped.
+bool getStoredSpan(const IPFEntryView &ent, ByteSpan &out, std::string &err);
+
+// Write a stored entry to outPath without a round trip through a vector:
+// copy_file_range, then sendfile, on Linux; a write straight from the mapping
+// elsewhere; chunked reads when the container is not mapped. With verifyCrc
+// the mapped bytes are checked before anything is written.
+bool copyStoredEntryToPath(const IPFEntryView &ent, const std::string &outPath, std::string &err,
+                           bool verifyCrc = false);
+
+#endif // PASSTHROUGH_HPP
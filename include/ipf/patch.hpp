@@ -0,0 +1,40 @@
+#if !defined(PATCH_HPP)
+#define PATCH_HPP
+#include "ipf/ipf_vfs.hpp"
+#include "ipf/ipf_writer.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// Difference between two mounted client states, by logical path. Entries are
+// compared on their table records only (CRC32 of the stored bytes plus both
+// sizes), so nothing is read from the containers.
+struct IPFDiff
+{
+    std::vector<uint32_t> added;                          // rows of the newer state
+    std::vector<std::pair<uint32_t, uint32_t>> changed;   // (older row, newer row)
+    std::vector<uint32_t> removed;                        // rows of the older state
+    uint64_t unchanged = 0;
+
+    bool empty() const { return added.empty() && changed.empty() && removed.empty(); }
+    std::string toString() const;
+};
+
+void diffFileSystems(const IPFFileSystem &from, const IPFFileSystem &to, IPFDiff &diff);
+
+// Write the added and changed entries of diff, copied verbatim from the newer
+// state, as patch containers: outPath, then outPath_1.ipf, ... when one
+// container would exceed 65535 entries or 2 GB. The header goes from
+// from.getVersion() to to.getVersion() unless options set the versions.
+// IPF has no deletion record, so removed entries are only reported.
+bool writePatch(const IPFFileSystem &from, const IPFFileSystem &to, const IPFDiff &diff, const std::string &outPath,
+                IPFWriterOptions options, std::vector<std::string> &written, IPFWriteStats &stats, std::string &err);
+
+// Fold a patch container into one base container: entries of the patch that
+// belong to the base (same container name) replace or extend it, everything
+// else is copied verbatim. The result carries the patch's new_version.
+bool applyPatch(const std::string &basePath, const std::string &patchPath, const std::string &outPath,
+                IPFWriterOptions options, IPFWriteStats &stats, std::string &err);
+
+#endif // PATCH_HPP
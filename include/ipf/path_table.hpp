@@ -0,0 +1,123 @@
+#if !defined(PATH_TABLE_HPP)
+#define PATH_TABLE_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/span.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// ASCII case folding used for every logical path comparison (matches strcasecmp).
+inline char foldPathChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+uint32_t hashPathNoCase(StringRef path);
+bool equalsPathNoCase(StringRef a, StringRef b);
+// Case-insensitive ordering; comparePathSuffixNoCase compares the strings read backwards.
+int comparePathNoCase(StringRef a, StringRef b);
+int comparePathSuffixNoCase(StringRef a, StringRef b);
+
+// Open-addressing hash set of IPFIndex rows keyed by their logical path,
+// compared case-insensitively. Keys are not copied: slots hold the row id and
+// its hash, the path itself is read back from the index arena.
+class PathHashTable
+{
+public:
+    void reset(const IPFIndex *index, size_t expectedEntries);
+
+    // Insert row, or replace the row already stored under the same path.
+    // Returns the replaced row, or NO_ROW.
+    uint32_t insertOrReplace(uint32_t row);
+    uint32_t find(StringRef path) const;
+
+    size_t size() const { return count; }
+
+    // Rows currently stored, in slot order.
+    template <typename F>
+    void forEachRow(F &&f) const
+    {
+        for (uint32_t r : rows)
+            if (r != NO_ROW)
+                f(r);
+    }
+
+    // Slot image for the on-disk index cache; deserialize binds the table to index.
+    void serialize(ByteWriter &out) const;
+    bool deserialize(ByteCursor &in, const IPFIndex *index, std::string &err);
+
+    static const uint32_t NO_ROW = 0xFFFFFFFFu;
+
+private:
+    void grow();
+
+    const IPFIndex *owner = nullptr;
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> hashes;
+    size_t mask = 0;
+    size_t count = 0;
+};
+
+// Contiguous run of rows inside one of PathIndex's sorted orders.
+struct RowRange
+{
+    const uint32_t *first = nullptr;
+    const uint32_t *last = nullptr;
+
+    RowRange() = default;
+    RowRange(const uint32_t *b, const uint32_t *e) : first(b), last(e) {}
+
+    bool empty() const { return first == last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return last; }
+};
+
+// Path lookups over an IPFIndex: the hash table answers exact paths, a
+// case-insensitively sorted copy of the rows answers prefix and directory
+// queries with binary searches, and a second copy sorted by reversed path
+// answers suffix queries such as "*.ies".
+class PathIndex
+{
+public:
+    // Fill the hash side one row at a time (a later row replaces an earlier
+    // one with the same path), then call finalize to build the sorted orders.
+    void reset(const IPFIndex *index, size_t expectedEntries);
+    uint32_t insertOrReplace(uint32_t row) { return table.insertOrReplace(row); }
+    void finalize();
+
+    // reset, insert every row of index, finalize.
+    void build(const IPFIndex &index);
+
+    size_t size() const { return table.size(); }
+    const PathHashTable &getTable() const { return table; }
+
+    uint32_t find(StringRef path) const { return table.find(path); }
+
+    // Every row, ordered by path.
+    RowRange getSorted() const { return RowRange(sorted.data(), sorted.data() + sorted.size()); }
+    // Rows whose path starts (or ends) with the given text, in the matching sort order.
+    RowRange findPrefix(StringRef prefix) const;
+    RowRange findSuffix(StringRef suffix) const;
+
+    // Immediate children of dir ("" is the root, trailing '/' optional).
+    // Subdirectory names point into the index arena.
+    void listDirectory(StringRef dir, std::vector<StringRef> &subdirs, std::vector<uint32_t> &files) const;
+
+    // Rows matching a matchGlob pattern, ordered by path. Only the narrower of
+    // the literal-prefix and literal-suffix ranges is actually tested.
+    void glob(StringRef pattern, std::vector<uint32_t> &out) const;
+
+    void serialize(ByteWriter &out) const;
+    bool deserialize(ByteCursor &in, const IPFIndex *index, std::string &err);
+
+private:
+    StringRef pathOf(uint32_t row) const { return owner->getEntry(row).getDirectoryName(); }
+
+    const IPFIndex *owner = nullptr;
+    PathHashTable table;
+    std::vector<uint32_t> sorted;
+    std::vector<uint32_t> sorted_reversed;
+};
+
+#endif // PATH_TABLE_HPP
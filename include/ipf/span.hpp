@@ -0,0 +1,72 @@
+#if !defined(SPAN_HPP)
+#define SPAN_HPP
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+
+// Non-owning read-only view over a contiguous byte range (C++14 stand-in for std::span).
+struct ByteSpan
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    ByteSpan() = default;
+    ByteSpan(const uint8_t *ptr, size_t count) : data(ptr), size(count) {}
+
+    bool empty() const { return size == 0; }
+    const uint8_t *begin() const { return data; }
+    const uint8_t *end() const { return data + size; }
+    const uint8_t &operator[](size_t i) const { return data[i]; }
+
+    ByteSpan subspan(size_t offset, size_t count) const { return ByteSpan(data + offset, count); }
+};
+
+// Non-owning writable view over a contiguous byte range.
+struct MutableByteSpan
+{
+    uint8_t *data = nullptr;
+    size_t size = 0;
+
+    MutableByteSpan() = default;
+    MutableByteSpan(uint8_t *ptr, size_t count) : data(ptr), size(count) {}
+
+    bool empty() const { return size == 0; }
+    uint8_t *begin() const { return data; }
+    uint8_t *end() const { return data + size; }
+    uint8_t &operator[](size_t i) const { return data[i]; }
+
+    operator ByteSpan() const { return ByteSpan(data, size); }
+};
+
+// Non-owning view over characters (C++14 stand-in for std::string_view).
+struct StringRef
+{
+    const char *data = nullptr;
+    size_t size = 0;
+
+    StringRef() = default;
+    StringRef(const char *ptr, size_t count) : data(ptr), size(count) {}
+    StringRef(const std::string &s) : data(s.data()), size(s.size()) {}
+
+    bool empty() const { return size == 0; }
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+    char operator[](size_t i) const { return data[i]; }
+
+    StringRef substr(size_t offset, size_t count = static_cast<size_t>(-1)) const
+    {
+        if (offset > size)
+            offset = size;
+        if (count > size - offset)
+            count = size - offset;
+        return StringRef(data + offset, count);
+    }
+
+    std::string str() const { return std::string(data, size); }
+
+    bool operator==(const StringRef &o) const { return size == o.size && (size == 0 || std::memcmp(data, o.data, size) == 0); }
+    bool operator!=(const StringRef &o) const { return !(*this == o); }
+};
+
+#endif // SPAN_HPP
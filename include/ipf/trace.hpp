@@ -0,0 +1,79 @@
+#if !defined(TRACE_HPP)
+#define TRACE_HPP
+#include <string>
+#include <stdint.h>
+
+// Scoped timers for the extraction hot paths. Build with KLAIPEDA_TRACE
+// defined to compile them in; without it every IPF_TRACE_* macro expands to
+// nothing and the export functions only report that tracing is missing.
+//
+// Each thread records into its own ring buffer of the most recent events plus
+// per-category counters and a log2 duration histogram, so recording takes no
+// lock. Export once the work being measured has finished.
+
+enum class TraceCategory : uint8_t
+{
+    Open,    // mapping or opening a container
+    Parse,   // reading a container's header and file table
+    Read,    // copying stored bytes out of a container
+    Decrypt, // entry cipher
+    Inflate, // raw deflate
+    Verify,  // CRC32 of stored bytes
+    Write,   // output files
+    Extract, // one entry end to end in bulk extraction
+    Count
+};
+
+const char *getTraceCategoryName(TraceCategory category);
+
+// Events kept per thread; older ones are overwritten, counters keep everything.
+const size_t TRACE_RING_CAPACITY = 1u << 16;
+
+// Recording is off until enabled, so a tracing build costs one relaxed load per scope when idle.
+void setTracingEnabled(bool enabled);
+bool isTracingEnabled();
+void resetTrace();
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto): one complete event per scope.
+bool writeChromeTrace(const std::string &path, std::string &err);
+// Per category: count, total and mean time, bytes, p50/p90/p99 and a histogram.
+std::string getTraceSummary();
+
+#if defined(KLAIPEDA_TRACE)
+
+class TraceScope
+{
+public:
+    explicit TraceScope(TraceCategory category, uint64_t bytes = 0);
+    ~TraceScope();
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    void setBytes(uint64_t value) { bytes = value; }
+
+private:
+    TraceCategory category;
+    uint64_t bytes;
+    uint64_t start_ns; // 0 when tracing was off at construction
+};
+
+#define IPF_TRACE_CONCAT_INNER(a, b) a##b
+#define IPF_TRACE_CONCAT(a, b) IPF_TRACE_CONCAT_INNER(a, b)
+#define IPF_TRACE_SCOPE(category) TraceScope IPF_TRACE_CONCAT(trace_scope_, __LINE__)(TraceCategory::category)
+#define IPF_TRACE_SCOPE_BYTES(category, bytes) \
+    TraceScope IPF_TRACE_CONCAT(trace_scope_, __LINE__)(TraceCategory::category, (bytes))
+// A scope whose byte count is only known once the work is done
+#define IPF_TRACE_SCOPE_AS(name, category) TraceScope name(TraceCategory::category)
+#define IPF_TRACE_SET_BYTES(name, bytes) name.setBytes(bytes)
+
+#else
+
+#define IPF_TRACE_SCOPE(category) ((void)0)
+#define IPF_TRACE_SCOPE_BYTES(category, bytes) ((void)0)
+#define IPF_TRACE_SCOPE_AS(name, category) ((void)0)
+#define IPF_TRACE_SET_BYTES(name, bytes) ((void)(bytes))
+
+#endif // KLAIPEDA_TRACE
+
+#endif // TRACE_HPP
@@ -1,13 +1,56 @@
 #if !defined(UTILS_HPP)
 #define UTILS_HPP
 
+#include "ipf/span.hpp"
 #include <vector>
 #include <cstdint>
 #include <string>
 
+// Hex dump of data to stdout (see hex_dump.hpp).
 void printHexViewer(const std::vector<uint8_t> &data);
 void logInfo(const std::string &msg);
 void logWarn(const std::string &msg);
 void logError(const std::string &msg);
 
+// Case-insensitive glob match: '*' matches any run of characters (including '/'), '?' exactly one.
+bool matchGlob(StringRef pattern, StringRef text);
+
+// mkdir -p; succeeds when the directory already exists.
+bool createDirectories(const std::string &path);
+bool writeFileBytes(const std::string &path, const uint8_t *data, size_t size);
+
+// Enough to tell whether a container changed since it was indexed: size and
+// modification time from the file system, plus the patch versions from the
+// container header, which a repack within the timestamp resolution still changes.
+struct FileStamp
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;     // seconds since the epoch
+    uint32_t mtime_ns = 0; // sub-second part, where the file system keeps one
+    uint32_t version_to_patch = 0;
+    uint32_t new_version = 0;
+
+    bool operator==(const FileStamp &o) const
+    {
+        return size == o.size && mtime == o.mtime && mtime_ns == o.mtime_ns &&
+               version_to_patch == o.version_to_patch && new_version == o.new_version;
+    }
+    bool operator!=(const FileStamp &o) const { return !(*this == o); }
+};
+// Fills size and modification time only; the versions are up to the caller.
+bool getFileStamp(const std::string &path, FileStamp &out);
+
+// Rename from over to, replacing it (rename alone does not overwrite on Windows).
+bool replaceFile(const std::string &from, const std::string &to);
+// Write to a temporary next to path and rename it over path, so readers never see a partial file.
+bool replaceFileBytes(const std::string &path, const uint8_t *data, size_t size);
+
+// Make to a hard link of from, replacing whatever is at to; copies the bytes
+// instead when the filesystem cannot link (FAT, different volumes).
+bool linkOrCopyFile(const std::string &from, const std::string &to);
+
+// Append every regular file below dir whose name ends with extension (case-insensitive), recursing into subdirectories.
+bool listFilesRecursive(const std::string &dir, const std::string &extension, std::vector<std::string> &out);
+bool isDirectory(const std::string &path);
+
 #endif // UTILS_HPP
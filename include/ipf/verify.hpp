@@ -0,0 +1,33 @@
+#if !defined(VERIFY_HPP)
+#define VERIFY_HPP
+#include "ipf/ipf_index.hpp"
+#include "ipf/span.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// The file table crc32 covers the bytes as stored in the container (after
+// deflate and the cipher), so integrity can be checked without inflating.
+bool checkStoredCrc(uint32_t expected, uint32_t actual, std::string &err);
+bool verifyStoredBytes(ByteSpan stored, uint32_t expected, std::string &err);
+
+// Check one entry against its stored CRC32 (reads the payload, never inflates).
+bool verifyEntry(const IPFEntryView &ent, std::string &err);
+
+struct VerifyStats
+{
+    uint64_t entries = 0;  // checked
+    uint64_t failures = 0; // CRC mismatches and read errors
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    std::vector<std::string> errors;
+
+    double getMegabytesPerSecond() const;
+    std::string toString() const;
+};
+
+// Verify every entry of every container in the index on threadCount threads
+// (0 = hardware concurrency). Containers are read front to back.
+bool verifyAll(const IPFIndex &index, size_t threadCount, VerifyStats &stats);
+
+#endif // VERIFY_HPP
@@ -5,26 +5,121 @@
 #include <functional>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <condition_variable>
 #include <mutex>
 #include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <stdint.h>
+
+enum class SchedulingMode
+{
+    SharedQueue, // one FIFO queue behind one mutex
+    WorkStealing // per-worker deques, idle workers steal from the others
+};
 
 class ThreadPool
 {
 public:
-    ThreadPool(size_t threads);
+    ThreadPool(size_t threads, SchedulingMode mode = SchedulingMode::SharedQueue);
     ~ThreadPool();
 
     template <class F, class... Args>
     auto enqueue(F &&f, Args &&...args) -> std::future<typename std::result_of<F(Args...)>::type>;
 
+    // Queue many tasks at once: one lock per worker deque and a single wake-up.
+    // Tasks are started roughly in the order given, so put the heaviest first.
+    void enqueueBatch(std::vector<std::function<void()>> &&batch);
+
+    // Run body(rangeBegin, rangeEnd) over [begin, end) in chunks of `grain` and
+    // wait for all of them. Rethrows the first exception thrown by a chunk.
+    template <class F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F &&body);
+
+    // Like parallelFor over [0, count), but ranges are cut so each carries about
+    // grainWeight of weight(i); an item heavier than that gets a range of its own.
+    template <class W, class F>
+    void parallelForWeighted(size_t count, W &&weight, uint64_t grainWeight, F &&body);
+
+    size_t size() const { return workers.size(); }
+    SchedulingMode getMode() const { return mode; }
+
 private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void submit(std::function<void()> &&task);
+    void runWorker(size_t index);
+    bool tryRunPendingTask();
+    bool popTask(size_t index, std::function<void()> &task);
+    void runRanges(const std::vector<std::pair<size_t, size_t>> &ranges, const std::function<void(size_t, size_t)> &body);
+
     std::vector<std::thread> workers;
     std::queue<std::function<void()>> tasks;
 
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop = false;
+
+    SchedulingMode mode;
+    std::vector<std::unique_ptr<WorkerQueue>> local_queues;
+    std::atomic<size_t> pending{0}; // tasks sitting in local_queues
+    std::atomic<size_t> next_queue{0};
 };
 
+// Defined in the header so every translation unit can instantiate it.
+template <class F, class... Args>
+auto ThreadPool::enqueue(F &&f, Args &&...args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    using return_type = typename std::result_of<F(Args...)>::type;
+    auto task_ptr = std::make_shared<std::packaged_task<return_type()>>(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+    std::future<return_type> res = task_ptr->get_future();
+    submit([task_ptr]()
+           { (*task_ptr)(); });
+    return res;
+}
+
+template <class F>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, F &&body)
+{
+    if (grain == 0)
+        grain = 1;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t i = begin; i < end; i += grain)
+        ranges.emplace_back(i, end - i > grain ? i + grain : end);
+    runRanges(ranges, std::function<void(size_t, size_t)>(std::forward<F>(body)));
+}
+
+template <class W, class F>
+void ThreadPool::parallelForWeighted(size_t count, W &&weight, uint64_t grainWeight, F &&body)
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t rangeStart = 0;
+    uint64_t rangeWeight = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t w = weight(i);
+        if (i > rangeStart && rangeWeight + w > grainWeight)
+        {
+            ranges.emplace_back(rangeStart, i);
+            rangeStart = i;
+            rangeWeight = 0;
+        }
+        rangeWeight += w;
+    }
+    if (rangeStart < count)
+        ranges.emplace_back(rangeStart, count);
+    runRanges(ranges, std::function<void(size_t, size_t)>(std::forward<F>(body)));
+}
+
 #endif // THREAD_POOL_HPP
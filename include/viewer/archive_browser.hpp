@@ -0,0 +1,56 @@
+#if !defined(ARCHIVE_BROWSER_HPP)
+#define ARCHIVE_BROWSER_HPP
+#include "ipf/archive_tree.hpp"
+#include "ipf/async_extract.hpp"
+#include "ipf/hex_dump.hpp"
+#include "ipf/ipf_vfs.hpp"
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// The viewer's main window: the mounted client as a lazily expanded tree (or
+// the filter's matches while a filter is typed) next to a hex preview of the
+// selected entry. Every list goes through ImGuiListClipper, so a frame costs
+// the same for 100 rows as for 500k; extraction runs on the ExtractionService
+// workers and the filter advances a few milliseconds per frame.
+class ArchiveBrowser
+{
+public:
+    // path is a client data directory or a single .ipf; cachePath as for IPFFileSystem::mountCached.
+    bool open(const std::string &path, const std::string &cachePath, std::vector<std::string> &warnings);
+
+    void draw();
+
+private:
+    void drawFilter();
+    void drawTree();
+    void drawMatches();
+    void drawPreview();
+
+    void select(uint32_t row);
+    void pollPreview();
+    void advanceFilter();
+
+    std::string title;
+    IPFFileSystem fs;
+    ArchiveTree tree;
+    PathFilter filter;
+    std::unique_ptr<ExtractionService> extractor;
+
+    char filter_text[256] = {};
+    bool has_selection = false;
+    uint32_t selected_row = 0;
+    bool scroll_to_selection = false;
+    size_t scroll_row = 0; // tree row of the selection, after a reveal
+
+    // Preview of selected_row; data stays empty until the extraction lands
+    CancellationToken preview_token;
+    std::future<ExtractResult> preview_request;
+    SharedBytes preview_data;
+    std::string preview_error;
+    std::string hex_lines; // reused every frame for the visible lines
+};
+
+#endif // ARCHIVE_BROWSER_HPP
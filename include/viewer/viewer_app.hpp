@@ -0,0 +1,10 @@
+#if !defined(VIEWER_APP_HPP)
+#define VIEWER_APP_HPP
+#include <string>
+
+// Open a GLFW window with an OpenGL 3.3 core context and run the ImGui
+// archive browser over path (a client data directory or one .ipf) until the
+// window is closed. Returns the process exit code.
+int runViewer(const std::string &path, const std::string &cachePath);
+
+#endif // VIEWER_APP_HPP
@@ -0,0 +1,291 @@
+#include "ipf/archive_tree.hpp"
+#include "ipf/utils.hpp"
+
+#include <algorithm>
+
+const uint32_t ArchiveTree::NO_NODE;
+const size_t PathFilter::MAX_FINISHED;
+
+namespace
+{
+    StringRef lastComponent(StringRef path)
+    {
+        size_t start = path.size;
+        while (start > 0 && path[start - 1] != '/')
+            --start;
+        return path.substr(start);
+    }
+
+    std::string foldPath(const std::string &text)
+    {
+        std::string out(text);
+        for (char &c : out)
+            c = foldPathChar(c);
+        return out;
+    }
+
+    bool hasWildcard(const std::string &text)
+    {
+        return text.find_first_of("*?") != std::string::npos;
+    }
+
+    // needle is already case-folded
+    bool containsNoCase(StringRef haystack, const std::string &needle)
+    {
+        if (needle.size() > haystack.size)
+            return false;
+        size_t last = haystack.size - needle.size();
+        for (size_t i = 0; i <= last; ++i)
+        {
+            if (foldPathChar(haystack[i]) != needle[0])
+                continue;
+            size_t j = 1;
+            while (j < needle.size() && foldPathChar(haystack[i + j]) == needle[j])
+                ++j;
+            if (j == needle.size())
+                return true;
+        }
+        return false;
+    }
+}
+
+void ArchiveTree::reset(const IPFIndex *owner, const PathIndex *pathIndex)
+{
+    index = owner;
+    paths = pathIndex;
+    nodes.clear();
+    rows.clear();
+    nodes.push_back(Node());
+    list(0);
+    nodes[0].expanded = true;
+    appendVisible(0, 0, rows);
+}
+
+StringRef ArchiveTree::getName(size_t i) const
+{
+    const Row &row = rows[i];
+    if (row.node != NO_NODE)
+        return nodes[row.node].name;
+    return lastComponent(index->getEntry(row.entry).getDirectoryName());
+}
+
+void ArchiveTree::list(uint32_t node)
+{
+    if (nodes[node].listed)
+        return;
+    std::vector<StringRef> subdirs;
+    std::vector<uint32_t> files;
+    paths->listDirectory(nodes[node].path, subdirs, files);
+
+    // nodes grows below, so no references into it are held across push_back
+    nodes[node].listed = true;
+    nodes[node].files.swap(files);
+    nodes[node].children.reserve(subdirs.size());
+    nodes.reserve(nodes.size() + subdirs.size());
+    size_t parentLength = nodes[node].path.size;
+    for (const StringRef &name : subdirs)
+    {
+        // name is cut from a path that starts with this directory, so the
+        // child's own path is the text around it
+        Node child;
+        child.path = StringRef(name.data - parentLength, parentLength + name.size + 1);
+        child.name = name;
+        nodes[node].children.push_back(static_cast<uint32_t>(nodes.size()));
+        nodes.push_back(std::move(child));
+    }
+}
+
+void ArchiveTree::appendVisible(uint32_t node, uint32_t depth, std::vector<Row> &out)
+{
+    for (uint32_t child : nodes[node].children)
+    {
+        out.push_back(Row{child, 0, depth});
+        if (nodes[child].expanded)
+            appendVisible(child, depth + 1, out);
+    }
+    for (uint32_t entry : nodes[node].files)
+        out.push_back(Row{NO_NODE, entry, depth});
+}
+
+size_t ArchiveTree::subtreeEnd(size_t i) const
+{
+    size_t end = i + 1;
+    while (end < rows.size() && rows[end].depth > rows[i].depth)
+        ++end;
+    return end;
+}
+
+void ArchiveTree::toggle(size_t i)
+{
+    if (i >= rows.size() || !isDirectory(i))
+        return;
+    uint32_t node = rows[i].node;
+    if (nodes[node].expanded)
+    {
+        rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(i + 1), rows.begin() + static_cast<std::ptrdiff_t>(subtreeEnd(i)));
+        nodes[node].expanded = false;
+        return;
+    }
+
+    list(node);
+    nodes[node].expanded = true;
+    std::vector<Row> visible;
+    appendVisible(node, rows[i].depth + 1, visible);
+    rows.insert(rows.begin() + static_cast<std::ptrdiff_t>(i + 1), visible.begin(), visible.end());
+}
+
+void ArchiveTree::collapseAll()
+{
+    for (size_t i = 1; i < nodes.size(); ++i)
+        nodes[i].expanded = false;
+    rows.clear();
+    appendVisible(0, 0, rows);
+}
+
+bool ArchiveTree::reveal(StringRef path, size_t &row)
+{
+    // Walk down one component at a time; each lookup only scans the rows of
+    // the directory expanded in the previous step.
+    size_t begin = 0, end = rows.size();
+    uint32_t depth = 0;
+    size_t start = 0;
+    for (size_t slash = 0; slash < path.size; ++slash)
+    {
+        if (path[slash] != '/')
+            continue;
+        StringRef name = path.substr(start, slash - start);
+        start = slash + 1;
+
+        size_t i = begin;
+        while (i < end && !(rows[i].depth == depth && isDirectory(i) && equalsPathNoCase(nodes[rows[i].node].name, name)))
+            ++i;
+        if (i == end)
+            return false;
+        if (!isExpanded(i))
+            toggle(i);
+        begin = i + 1;
+        end = subtreeEnd(i);
+        ++depth;
+    }
+
+    StringRef name = path.substr(start);
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (rows[i].depth == depth && !isDirectory(i) && equalsPathNoCase(getName(i), name))
+        {
+            row = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PathFilter::reset(const IPFIndex *owner, const PathIndex *pathIndex)
+{
+    index = owner;
+    paths = pathIndex;
+    text.clear();
+    folded.clear();
+    glob = false;
+    scan_all = false;
+    candidates.clear();
+    next = 0;
+    matches.clear();
+    finished.clear();
+}
+
+void PathFilter::setText(const std::string &newText)
+{
+    if (newText == text)
+        return;
+
+    if (!text.empty() && isDone())
+    {
+        finished.erase(std::remove_if(finished.begin(), finished.end(), [this](const Finished &f)
+                                      { return f.text == text; }),
+                       finished.end());
+        if (finished.size() == MAX_FINISHED)
+            finished.erase(finished.begin());
+        finished.push_back(Finished{text, matches});
+    }
+
+    std::string newFolded = foldPath(newText);
+    bool newGlob = hasWildcard(newText);
+    std::vector<uint32_t> base;
+    bool narrowed = false;
+    for (auto it = finished.rbegin(); it != finished.rend(); ++it)
+    {
+        if (it->text == newText)
+        {
+            // Seen it recently: done without testing anything
+            text = newText;
+            folded = newFolded;
+            glob = newGlob;
+            scan_all = false;
+            candidates.clear();
+            next = 0;
+            matches = it->matches;
+            return;
+        }
+    }
+
+    // A substring filter that contains the previous one can only match a subset
+    // of what that matched, plus whatever it has not tested yet.
+    if (!newGlob && !text.empty() && !glob && newFolded.find(folded) != std::string::npos)
+    {
+        base = matches;
+        for (size_t i = next; i < candidateCount(); ++i)
+            base.push_back(candidate(i));
+        narrowed = true;
+    }
+    if (!newGlob)
+    {
+        for (const Finished &f : finished)
+        {
+            if (hasWildcard(f.text) || newFolded.find(foldPath(f.text)) == std::string::npos)
+                continue;
+            if (!narrowed || f.matches.size() < base.size())
+            {
+                base = f.matches;
+                narrowed = true;
+            }
+        }
+    }
+
+    text = newText;
+    folded = newFolded;
+    glob = newGlob;
+    scan_all = !narrowed && !text.empty();
+    candidates.swap(base);
+    if (!narrowed)
+        candidates.clear();
+    next = 0;
+    matches.clear();
+}
+
+bool PathFilter::isMatch(uint32_t row) const
+{
+    StringRef path = index->getEntry(row).getDirectoryName();
+    if (glob)
+        return matchGlob(StringRef(text), path);
+    return containsNoCase(path, folded);
+}
+
+bool PathFilter::step(size_t budget)
+{
+    size_t count = candidateCount();
+    size_t end = budget < count - std::min(next, count) ? next + budget : count;
+    for (; next < end; ++next)
+    {
+        uint32_t row = candidate(next);
+        if (isMatch(row))
+            matches.push_back(row);
+    }
+    return isDone();
+}
+
+float PathFilter::getProgress() const
+{
+    size_t count = candidateCount();
+    return count ? static_cast<float>(next) / static_cast<float>(count) : 1.0f;
+}
@@ -0,0 +1,202 @@
+#include "ipf/async_extract.hpp"
+
+#include <algorithm>
+
+ExtractionService::ExtractionService(const IPFIndex &index, const ExtractionServiceOptions &options, EntryCache *cache)
+    : index(index), options(options), cache(cache)
+{
+    if (!this->cache)
+    {
+        owned_cache.reset(new EntryCache());
+        this->cache = owned_cache.get();
+    }
+
+    file_order.resize(index.size());
+    for (uint32_t i = 0; i < index.size(); ++i)
+        file_order[i] = i;
+    std::sort(file_order.begin(), file_order.end(), [&index](uint32_t a, uint32_t b)
+              {
+        IPFEntryView ea = index.getEntry(a);
+        IPFEntryView eb = index.getEntry(b);
+        if (ea.getContainerId() != eb.getContainerId())
+            return ea.getContainerId() < eb.getContainerId();
+        return ea.getFilePointer() < eb.getFilePointer(); });
+    file_position.resize(index.size());
+    for (uint32_t i = 0; i < file_order.size(); ++i)
+        file_position[file_order[i]] = i;
+    row_requests.assign(index.size(), 0);
+
+    size_t threads = options.thread_count;
+    if (threads == 0)
+        threads = std::max<size_t>(1, std::min<size_t>(4, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back([this]
+                             { runWorker(); });
+}
+
+ExtractionService::~ExtractionService()
+{
+    std::vector<Request> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        abandoned.swap(queue);
+    }
+    condition.notify_all();
+    for (auto &w : workers)
+        w.join();
+
+    // Nobody is left to run these; resolve their futures as cancelled
+    for (auto &r : abandoned)
+    {
+        ExtractResult result;
+        result.row = r.row;
+        result.cancelled = true;
+        finish(r, result);
+    }
+}
+
+std::future<ExtractResult> ExtractionService::submit(uint32_t row, ExtractPriority priority,
+                                                     const CancellationToken &token, const ExtractCallback &callback)
+{
+    Request request;
+    request.row = row;
+    request.priority = priority;
+    request.generation = prefetch_generation.load(std::memory_order_relaxed);
+    request.token = token;
+    request.callback = callback;
+    request.promise = std::make_shared<std::promise<ExtractResult>>();
+    std::future<ExtractResult> future = request.promise->get_future();
+
+    if (row >= index.size())
+    {
+        ExtractResult result;
+        result.row = row;
+        result.error = "Row " + std::to_string(row) + " out of range";
+        finish(request, result);
+        return future;
+    }
+
+    push(std::move(request));
+    if (priority >= ExtractPriority::Normal && options.prefetch_count > 0)
+    {
+        size_t behind = std::min(options.prefetch_behind, options.prefetch_count);
+        prefetchNeighbours(row, options.prefetch_count - behind, behind);
+    }
+    return future;
+}
+
+void ExtractionService::prefetchNeighbours(uint32_t row, size_t ahead, size_t behind)
+{
+    if (row >= index.size())
+        return;
+    uint32_t container = index.getEntry(row).getContainerId();
+    size_t pos = file_position[row];
+    uint64_t generation = prefetch_generation.load(std::memory_order_relaxed);
+
+    auto queueAt = [&](size_t p)
+    {
+        IPFEntryView ent = index.getEntry(file_order[p]);
+        if (ent.getContainerId() != container)
+            return false;
+        if (ent.getFileSizeCompressed() > 0 && cache->contains(ent.getContainer(), ent.getFilePointer()))
+            return true;
+        Request request;
+        request.row = file_order[p];
+        request.priority = ExtractPriority::Prefetch;
+        request.generation = generation;
+        push(std::move(request), true);
+        return true;
+    };
+
+    for (size_t i = 1; i <= ahead && pos + i < file_order.size(); ++i)
+        if (!queueAt(pos + i))
+            break;
+    for (size_t i = 1; i <= behind && i <= pos; ++i)
+        if (!queueAt(pos - i))
+            break;
+}
+
+void ExtractionService::cancelPrefetches()
+{
+    prefetch_generation.fetch_add(1, std::memory_order_relaxed);
+
+    // Also drop them from the queue right away so they stop holding memory
+    std::lock_guard<std::mutex> lock(mutex);
+    auto end = std::remove_if(queue.begin(), queue.end(), [this](const Request &r)
+                              {
+        if (r.priority != ExtractPriority::Prefetch)
+            return false;
+        --row_requests[r.row];
+        return true; });
+    queue.erase(end, queue.end());
+    std::make_heap(queue.begin(), queue.end(), RequestOrder());
+}
+
+size_t ExtractionService::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+bool ExtractionService::push(Request &&request, bool unlessPending)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (unlessPending && row_requests[request.row] > 0)
+            return false;
+        ++row_requests[request.row];
+        request.sequence = next_sequence++;
+        queue.push_back(std::move(request));
+        std::push_heap(queue.begin(), queue.end(), RequestOrder());
+    }
+    condition.notify_one();
+    return true;
+}
+
+void ExtractionService::runWorker()
+{
+    for (;;)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]
+                           { return stop || !queue.empty(); });
+            if (stop)
+                return;
+            std::pop_heap(queue.begin(), queue.end(), RequestOrder());
+            request = std::move(queue.back());
+            queue.pop_back();
+        }
+        run(request);
+    }
+}
+
+void ExtractionService::run(Request &request)
+{
+    ExtractResult result;
+    result.row = request.row;
+
+    bool stalePrefetch = request.priority == ExtractPriority::Prefetch &&
+                         request.generation != prefetch_generation.load(std::memory_order_relaxed);
+    if (stalePrefetch || request.token.isCancelled())
+        result.cancelled = true;
+    else
+        result.ok = cache->get(index.getEntry(request.row), result.data, result.error, options.verify_crc);
+
+    // Done with the row: a prefetch of it now either hits the cache or decodes it again after a failure
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --row_requests[request.row];
+    }
+    finish(request, result);
+}
+
+void ExtractionService::finish(Request &request, ExtractResult &result)
+{
+    if (request.callback)
+        request.callback(result);
+    if (request.promise)
+        request.promise->set_value(std::move(result));
+}
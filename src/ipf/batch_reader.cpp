@@ -0,0 +1,533 @@
+#include "ipf/batch_reader.hpp"
+#include "ipf/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#define IPF_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
+#endif
+#endif
+
+namespace
+{
+    // Blocking reads on network filesystems overlap well; more threads than
+    // this mostly adds contention on local disks.
+    const unsigned MAX_READ_THREADS = 8;
+
+    struct ReadRequest
+    {
+        intptr_t file = -1;
+        uint64_t offset = 0;
+        uint8_t *dst = nullptr;
+        size_t size = 0;
+        size_t done = 0; // bytes already read, for short reads
+        uint64_t tag = 0;
+    };
+
+    bool readFully(const ReadRequest &request, std::string &err)
+    {
+        uint8_t *dst = request.dst;
+        uint64_t offset = request.offset;
+        size_t left = request.size;
+        while (left > 0)
+        {
+#if defined(_WIN32)
+            OVERLAPPED at = {};
+            at.Offset = static_cast<DWORD>(offset);
+            at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(left, 1u << 30));
+            DWORD got = 0;
+            if (!ReadFile(reinterpret_cast<HANDLE>(request.file), dst, chunk, &got, &at))
+            {
+                err = "ReadFile failed with error " + std::to_string(GetLastError());
+                return false;
+            }
+            size_t n = got;
+#else
+            ssize_t got = ::pread(static_cast<int>(request.file), dst, left, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+            {
+                err = std::string("read failed: ") + std::strerror(errno);
+                return false;
+            }
+            size_t n = static_cast<size_t>(got);
+#endif
+            if (n == 0)
+            {
+                err = "read past the end of the file";
+                return false;
+            }
+            dst += n;
+            offset += n;
+            left -= n;
+        }
+        return true;
+    }
+}
+
+class ReadBackend
+{
+public:
+    virtual ~ReadBackend() {}
+    virtual void start(const ReadRequest &request) = 0;
+    virtual void collect(std::vector<ReadCompletion> &done, size_t minComplete) = 0;
+    virtual const char *getName() const = 0;
+};
+
+namespace
+{
+    // A few threads doing blocking positional reads
+    class ThreadReadBackend : public ReadBackend
+    {
+    public:
+        explicit ThreadReadBackend(unsigned threadCount)
+        {
+            for (unsigned i = 0; i < threadCount; ++i)
+                workers.emplace_back([this]()
+                                     { run(); });
+        }
+
+        ~ThreadReadBackend() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            work_ready.notify_all();
+            for (auto &w : workers)
+                w.join();
+        }
+
+        void start(const ReadRequest &request) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(request);
+            }
+            work_ready.notify_one();
+        }
+
+        void collect(std::vector<ReadCompletion> &done, size_t minComplete) override
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished_ready.wait(lock, [&]()
+                                { return finished.size() >= minComplete; });
+            for (auto &c : finished)
+                done.push_back(std::move(c));
+            finished.clear();
+        }
+
+        const char *getName() const override { return "threads"; }
+
+    private:
+        void run()
+        {
+            for (;;)
+            {
+                ReadRequest request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    work_ready.wait(lock, [this]()
+                                    { return stop || !queue.empty(); });
+                    if (stop)
+                        return; // reads nobody will collect are dropped
+                    request = queue.front();
+                    queue.pop_front();
+                }
+                ReadCompletion completion;
+                completion.tag = request.tag;
+                completion.ok = readFully(request, completion.error);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.push_back(std::move(completion));
+                }
+                finished_ready.notify_one();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable work_ready;
+        std::condition_variable finished_ready;
+        std::deque<ReadRequest> queue;
+        std::vector<ReadCompletion> finished;
+        bool stop = false;
+    };
+
+#if defined(IPF_HAVE_IO_URING)
+    // io_uring through the raw syscalls. Every request occupies one slot until
+    // it completes; short reads go back into the submission queue for the rest.
+    // If the ring stops working, everything moves over to a ThreadReadBackend.
+    class UringReadBackend : public ReadBackend
+    {
+    public:
+        explicit UringReadBackend(unsigned queueDepth) : slots(queueDepth)
+        {
+            for (size_t i = queueDepth; i > 0; --i)
+                free_slots.push_back(i - 1);
+
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+            if (fd < 0)
+                return; // ENOSYS on old kernels, EPERM under seccomp or io_uring_disabled
+            ring_fd = fd;
+            if (!mapRings(params))
+                closeRing();
+        }
+
+        ~UringReadBackend() override { closeRing(); }
+
+        bool ok() const { return ring_fd >= 0; }
+
+        void start(const ReadRequest &request) override
+        {
+            if (fallback)
+            {
+                fallback->start(request);
+                return;
+            }
+            size_t slot = free_slots.back();
+            free_slots.pop_back();
+            slots[slot].request = request;
+            queued.push_back(slot);
+        }
+
+        void collect(std::vector<ReadCompletion> &done, size_t minComplete) override
+        {
+            if (fallback)
+            {
+                fallback->collect(done, minComplete);
+                return;
+            }
+            size_t wanted = done.size() + minComplete;
+            for (;;)
+            {
+                fillSubmissionQueue();
+                reapCompletions(done);
+                unsigned toSubmit = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+                bool wait = done.size() < wanted;
+                if (toSubmit == 0 && !wait && queued.empty())
+                    return;
+                long ret = syscall(__NR_io_uring_enter, ring_fd, toSubmit, wait ? 1u : 0u,
+                                   wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+                if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    switchToThreads(done, errno);
+                    fallback->collect(done, done.size() < wanted ? wanted - done.size() : 0);
+                    return;
+                }
+            }
+        }
+
+        const char *getName() const override { return fallback ? fallback->getName() : "io_uring"; }
+
+    private:
+        struct Slot
+        {
+            ReadRequest request;
+            iovec iov;
+        };
+
+        bool mapRings(const io_uring_params &params)
+        {
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMap = false;
+#if defined(IORING_FEAT_SINGLE_MMAP)
+            singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+            if (singleMap)
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+            sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+            if (sq_ring == MAP_FAILED)
+            {
+                sq_ring = nullptr;
+                return false;
+            }
+            if (singleMap)
+                cq_ring = sq_ring;
+            else
+            {
+                cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+                if (cq_ring == MAP_FAILED)
+                {
+                    cq_ring = nullptr;
+                    return false;
+                }
+            }
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void *sqeMap = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+            if (sqeMap == MAP_FAILED)
+                return false;
+            sqes = static_cast<io_uring_sqe *>(sqeMap);
+
+            uint8_t *sq = static_cast<uint8_t *>(sq_ring);
+            sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            sq_entries = params.sq_entries;
+            uint8_t *cq = static_cast<uint8_t *>(cq_ring);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        void closeRing()
+        {
+            if (sqes)
+                munmap(sqes, sqes_size);
+            if (cq_ring && cq_ring != sq_ring)
+                munmap(cq_ring, cq_ring_size);
+            if (sq_ring)
+                munmap(sq_ring, sq_ring_size);
+            if (ring_fd >= 0)
+                ::close(ring_fd);
+            sqes = nullptr;
+            cq_ring = sq_ring = nullptr;
+            ring_fd = -1;
+        }
+
+        void fillSubmissionQueue()
+        {
+            unsigned tail = *sq_tail; // only this thread moves the tail
+            unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            while (!queued.empty() && tail - head < sq_entries)
+            {
+                size_t slot = queued.front();
+                queued.pop_front();
+                Slot &s = slots[slot];
+                s.iov.iov_base = s.request.dst + s.request.done;
+                s.iov.iov_len = s.request.size - s.request.done;
+
+                // READV rather than READ: the latter needs Linux 5.6
+                unsigned index = tail & sq_mask;
+                io_uring_sqe &sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READV;
+                sqe.fd = static_cast<int>(s.request.file);
+                sqe.off = s.request.offset + s.request.done;
+                sqe.addr = reinterpret_cast<uint64_t>(&s.iov);
+                sqe.len = 1;
+                sqe.user_data = slot;
+                sq_array[index] = index;
+                ++tail;
+                ++in_flight;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+        }
+
+        void reapCompletions(std::vector<ReadCompletion> &done)
+        {
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe &cqe = cqes[head & cq_mask];
+                --in_flight;
+                size_t slot = static_cast<size_t>(cqe.user_data);
+                ReadRequest &request = slots[slot].request;
+                size_t left = request.size - request.done;
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN || (cqe.res > 0 && static_cast<size_t>(cqe.res) < left))
+                {
+                    if (cqe.res > 0)
+                        request.done += static_cast<size_t>(cqe.res);
+                    queued.push_back(slot);
+                    continue;
+                }
+                ReadCompletion completion;
+                completion.tag = request.tag;
+                completion.ok = cqe.res >= 0 && (cqe.res > 0 || left == 0);
+                if (cqe.res < 0)
+                    completion.error = std::string("read failed: ") + std::strerror(-cqe.res);
+                else if (!completion.ok)
+                    completion.error = "read past the end of the file";
+                done.push_back(std::move(completion));
+                free_slots.push_back(slot);
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        // The ring is unusable. Reads the kernel already took may still land in
+        // their buffers, and a buffer is released as soon as its read is
+        // collected, so every one of them is waited for before the rest moves
+        // to the thread backend.
+        void switchToThreads(std::vector<ReadCompletion> &done, int error)
+        {
+            logWarn(std::string("io_uring_enter failed: ") + std::strerror(error) + ", reading with threads instead");
+
+            // Entries the kernel has not consumed were never started; take them back
+            unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            for (unsigned tail = *sq_tail; tail != head; --tail)
+            {
+                queued.push_front(static_cast<size_t>(sqes[(tail - 1) & sq_mask].user_data));
+                --in_flight;
+            }
+            __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+
+            while (in_flight > 0)
+            {
+                reapCompletions(done);
+                if (in_flight == 0)
+                    break;
+                // Completions reach the CQ ring even if waiting for them fails
+                if (syscall(__NR_io_uring_enter, ring_fd, 0u, 1u, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            closeRing();
+
+            fallback.reset(new ThreadReadBackend(std::min(static_cast<unsigned>(slots.size()), MAX_READ_THREADS)));
+            for (size_t slot : queued)
+            {
+                // The thread backend has no notion of a partly done read
+                ReadRequest rest = slots[slot].request;
+                rest.dst += rest.done;
+                rest.offset += rest.done;
+                rest.size -= rest.done;
+                rest.done = 0;
+                fallback->start(rest);
+                free_slots.push_back(slot);
+            }
+            queued.clear();
+        }
+
+        std::vector<Slot> slots;
+        std::vector<size_t> free_slots;
+        std::deque<size_t> queued; // waiting for room in the submission queue
+        size_t in_flight = 0;      // in the submission queue or with the kernel
+        std::unique_ptr<ThreadReadBackend> fallback;
+
+        int ring_fd = -1;
+        void *sq_ring = nullptr;
+        void *cq_ring = nullptr;
+        size_t sq_ring_size = 0;
+        size_t cq_ring_size = 0;
+        size_t sqes_size = 0;
+        io_uring_sqe *sqes = nullptr;
+        unsigned *sq_head = nullptr;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned sq_mask = 0;
+        unsigned sq_entries = 0;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe *cqes = nullptr;
+    };
+#endif
+}
+
+BatchReader::BatchReader(unsigned queueDepth, bool allowUring) : queue_depth(std::max(1u, queueDepth))
+{
+#if defined(IPF_HAVE_IO_URING)
+    if (allowUring)
+    {
+        std::unique_ptr<UringReadBackend> uring(new UringReadBackend(queue_depth));
+        if (uring->ok())
+        {
+            backend = std::move(uring);
+            return;
+        }
+    }
+#else
+    (void)allowUring;
+#endif
+    backend.reset(new ThreadReadBackend(std::min(queue_depth, MAX_READ_THREADS)));
+}
+
+BatchReader::~BatchReader()
+{
+    backend.reset();
+    for (intptr_t file : files)
+    {
+#if defined(_WIN32)
+        CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+        ::close(static_cast<int>(file));
+#endif
+    }
+}
+
+int BatchReader::addFile(const std::string &path, std::string &err)
+{
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        err = "Failed to open " + path;
+        return -1;
+    }
+    files.push_back(reinterpret_cast<intptr_t>(handle));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        err = "Failed to open " + path + ": " + std::strerror(errno);
+        return -1;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    // Requests arrive sorted by offset; let the kernel read ahead accordingly
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    files.push_back(fd);
+#endif
+    return static_cast<int>(files.size() - 1);
+}
+
+bool BatchReader::submit(int file, uint64_t offset, uint8_t *dst, size_t size, uint64_t tag)
+{
+    if (pending_count >= queue_depth || file < 0 || static_cast<size_t>(file) >= files.size())
+        return false;
+    ReadRequest request;
+    request.file = files[file];
+    request.offset = offset;
+    request.dst = dst;
+    request.size = size;
+    request.tag = tag;
+    backend->start(request);
+    ++pending_count;
+    return true;
+}
+
+void BatchReader::collect(std::vector<ReadCompletion> &done, size_t minComplete)
+{
+    size_t before = done.size();
+    backend->collect(done, std::min(minComplete, pending_count));
+    pending_count -= done.size() - before;
+}
+
+const char *BatchReader::getBackendName() const { return backend->getName(); }
@@ -32,14 +32,15 @@ void BinaryReader::addError(const std::string &msg)
 {
     BinaryError e;
     e.message = msg;
-    e.position = tell();
+    // Query the stream directly: tell() reports failures through addError itself.
+    e.position = file.is_open() ? file.tellg() : std::streampos(-1);
     error_list.push_back(e);
     file_good = false;
 }
 
 bool BinaryReader::seek(std::streamoff off, std::ios::seekdir dir)
 {
-    if (!file)
+    if (!file.is_open())
     {
         addError("Seek on closed file");
         return false;
@@ -91,12 +92,23 @@ template bool BinaryReader::readLe<int64_t>(int64_t &);
 bool BinaryReader::readBytes(std::vector<uint8_t> &out, size_t count)
 {
     out.resize(count);
+    return readBytes(out.data(), count);
+}
+
+bool BinaryReader::readBytes(PooledBuffer &out, size_t count)
+{
+    out.resizeDiscard(count);
+    return readBytes(out.data(), count);
+}
+
+bool BinaryReader::readBytes(uint8_t *dst, size_t count)
+{
     if (!file)
     {
         addError("Read bytes on closed file");
         return false;
     }
-    file.read(reinterpret_cast<char *>(out.data()), count);
+    file.read(reinterpret_cast<char *>(dst), count);
     if (!file)
     {
         addError("Failed to read expected bytes (" + std::to_string(count) + ")");
@@ -0,0 +1,150 @@
+#include "ipf/buffer_pool.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+std::string BufferPoolStats::toString() const
+{
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "%llu acquires (%llu reused, %llu allocated), %.1f MB cached",
+                  static_cast<unsigned long long>(acquires), static_cast<unsigned long long>(reuses),
+                  static_cast<unsigned long long>(allocations), static_cast<double>(cached_bytes) / (1024.0 * 1024.0));
+    return buf;
+}
+
+BufferPool::~BufferPool() { trim(); }
+
+size_t BufferPool::getSizeClass(size_t size)
+{
+    size_t cls = MIN_BUFFER_SIZE_CLASS;
+    while (cls < size)
+        cls <<= 1;
+    return cls;
+}
+
+static size_t classIndex(size_t capacity)
+{
+    size_t index = 0;
+    while ((static_cast<size_t>(1) << index) < capacity)
+        ++index;
+    return index;
+}
+
+uint8_t *BufferPool::acquire(size_t minSize, size_t &capacity)
+{
+    capacity = getSizeClass(minSize);
+    size_t index = classIndex(capacity);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.acquires;
+        std::vector<uint8_t *> &list = free_lists[index];
+        if (!list.empty())
+        {
+            uint8_t *storage = list.back();
+            list.pop_back();
+            ++stats.reuses;
+            stats.cached_bytes -= capacity;
+            return storage;
+        }
+        ++stats.allocations;
+    }
+    // new[] of a scalar type leaves the bytes uninitialised
+    return new uint8_t[capacity];
+}
+
+void BufferPool::release(uint8_t *storage, size_t capacity)
+{
+    if (!storage)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stats.cached_bytes + capacity <= budget)
+        {
+            free_lists[classIndex(capacity)].push_back(storage);
+            stats.cached_bytes += capacity;
+            return;
+        }
+    }
+    delete[] storage;
+}
+
+void BufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &list : free_lists)
+    {
+        for (uint8_t *storage : list)
+            delete[] storage;
+        list.clear();
+    }
+    stats.cached_bytes = 0;
+}
+
+BufferPoolStats BufferPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+BufferPool &getBufferPool()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer &&other) noexcept
+    : pool(other.pool), storage(other.storage), length(other.length), cap(other.cap)
+{
+    other.storage = nullptr;
+    other.length = 0;
+    other.cap = 0;
+}
+
+PooledBuffer &PooledBuffer::operator=(PooledBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool = other.pool;
+        storage = other.storage;
+        length = other.length;
+        cap = other.cap;
+        other.storage = nullptr;
+        other.length = 0;
+        other.cap = 0;
+    }
+    return *this;
+}
+
+void PooledBuffer::resize(size_t count)
+{
+    if (count > cap)
+        grow(count, true);
+    length = count;
+}
+
+void PooledBuffer::resizeDiscard(size_t count)
+{
+    if (count > cap)
+        grow(count, false);
+    length = count;
+}
+
+void PooledBuffer::release()
+{
+    getPool().release(storage, cap);
+    storage = nullptr;
+    length = 0;
+    cap = 0;
+}
+
+void PooledBuffer::grow(size_t count, bool keep)
+{
+    size_t newCap = 0;
+    uint8_t *fresh = getPool().acquire(count, newCap);
+    if (keep && length)
+        std::memcpy(fresh, storage, length);
+    getPool().release(storage, cap);
+    storage = fresh;
+    cap = newCap;
+}
@@ -0,0 +1,589 @@
+#include "ipf/bulk_extract.hpp"
+#include "ipf/dedup.hpp"
+#include "ipf/entry_stream.hpp"
+#include "ipf/ipf_reader.hpp"
+#include "ipf/passthrough.hpp"
+#include "ipf/trace.hpp"
+#include "ipf/utils.hpp"
+#include "ipf/verify.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    struct Batch
+    {
+        size_t begin;
+        size_t end;
+        uint64_t weight; // uncompressed bytes, for largest-first scheduling
+    };
+
+    // Shared between tasks of one extractEntries call.
+    struct BulkContext
+    {
+        const IPFIndex *index;
+        const std::vector<uint32_t> *rows;
+        const BulkExtractOptions *options;
+        uint64_t call_id; // tells worker scratch apart from an earlier call's
+
+        std::atomic<uint64_t> entries{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::vector<uint8_t> done; // per index row, set once the row's file is complete (dedup only)
+        uint64_t linked = 0;
+
+        std::mutex error_mutex;
+        std::vector<std::string> errors;
+
+        void addError(const std::string &msg)
+        {
+            failures.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(error_mutex);
+            errors.push_back(msg);
+        }
+    };
+
+    // Per-worker state, reused across every batch the worker runs.
+    struct WorkerScratch
+    {
+        PooledBuffer output; // storage returns to the pool when the worker exits
+        PooledBuffer compressed;
+        std::string last_directory;
+        std::string path;
+        uint64_t call_id = 0;
+    };
+
+    std::atomic<uint64_t> next_call_id{1};
+
+    // Scratch is per thread, not per call, and a thread can work for several
+    // calls; directories an earlier call created may have been removed since.
+    WorkerScratch &workerScratch(const BulkContext &ctx)
+    {
+        static thread_local WorkerScratch scratch;
+        if (scratch.call_id != ctx.call_id)
+        {
+            scratch.last_directory.clear();
+            scratch.call_id = ctx.call_id;
+        }
+        return scratch;
+    }
+
+    // Names come from the archive; refuse anything that would escape output_dir.
+    bool isSafeRelativePath(StringRef name)
+    {
+        if (name.empty() || name[0] == '/' || name[0] == '\\' || (name.size > 1 && name[1] == ':'))
+            return false;
+        size_t segmentStart = 0;
+        for (size_t i = 0; i <= name.size; ++i)
+        {
+            if (i < name.size && name[i] != '/' && name[i] != '\\')
+                continue;
+            if (i - segmentStart == 2 && name[segmentStart] == '.' && name[segmentStart + 1] == '.')
+                return false;
+            segmentStart = i + 1;
+        }
+        return true;
+    }
+
+    // Build output_dir/name in scratch.path and make sure its directory exists.
+    bool prepareOutputPath(const BulkExtractOptions &options, StringRef name, WorkerScratch &scratch, std::string &err)
+    {
+        if (!isSafeRelativePath(name))
+        {
+            err = name.str() + ": unsafe output path";
+            return false;
+        }
+
+        scratch.path = options.output_dir;
+        scratch.path.push_back('/');
+        scratch.path.append(name.data, name.size);
+
+        // Neighbouring rows usually share a directory; skip the mkdir walk for those
+        size_t slash = scratch.path.find_last_of('/');
+        if (scratch.path.compare(0, slash, scratch.last_directory) != 0 || scratch.last_directory.size() != slash)
+        {
+            scratch.last_directory.assign(scratch.path, 0, slash);
+            if (!createDirectories(scratch.last_directory))
+            {
+                err = "Failed to create directory " + scratch.last_directory;
+                scratch.last_directory.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void finishEntry(BulkContext &ctx, const IPFEntryView &ent, uint64_t written)
+    {
+        if (!ctx.done.empty())
+            ctx.done[ent.getRow()] = 1;
+        ctx.entries.fetch_add(1, std::memory_order_relaxed);
+        ctx.bytes_in.fetch_add(ent.getFileSizeCompressed(), std::memory_order_relaxed);
+        ctx.bytes_out.fetch_add(written, std::memory_order_relaxed);
+    }
+
+    void extractOne(BulkContext &ctx, const IPFEntryView &ent, WorkerScratch &scratch)
+    {
+        IPF_TRACE_SCOPE_BYTES(Extract, ent.getFileSizeUncompressed());
+        std::string err;
+        StringRef name = ent.getDirectoryName();
+        if (!prepareOutputPath(*ctx.options, name, scratch, err))
+        {
+            ctx.addError(err);
+            return;
+        }
+
+        // Stored entries go container -> file without passing through a buffer;
+        // huge entries are streamed so a worker never holds them in memory whole
+        uint64_t written = ent.getFileSizeUncompressed();
+        if (ent.shouldSkipDecompression())
+        {
+            if (!copyStoredEntryToPath(ent, scratch.path, err, ctx.options->verify_crc))
+            {
+                ctx.addError(name.str() + ": " + err);
+                return;
+            }
+            written = ent.getFileSizeCompressed();
+        }
+        else if (written >= ctx.options->stream_threshold)
+        {
+            if (!extractFileToPath(ent, scratch.path, err, DEFAULT_STREAM_CHUNK_SIZE, ctx.options->verify_crc))
+            {
+                ctx.addError(name.str() + ": " + err);
+                return;
+            }
+        }
+        else
+        {
+            if (!extractFileData(ent, scratch.output, scratch.compressed, err, ctx.options->verify_crc))
+            {
+                ctx.addError(name.str() + ": " + err);
+                return;
+            }
+            if (!writeFileBytes(scratch.path, scratch.output.data(), scratch.output.size()))
+            {
+                ctx.addError("Failed to write " + scratch.path);
+                return;
+            }
+            written = scratch.output.size();
+        }
+        finishEntry(ctx, ent, written);
+    }
+
+    void runBatch(BulkContext &ctx, Batch batch)
+    {
+        WorkerScratch &scratch = workerScratch(ctx);
+        for (size_t i = batch.begin; i < batch.end; ++i)
+            extractOne(ctx, ctx.index->getEntry((*ctx.rows)[i]), scratch);
+    }
+
+    // One payload read by the BatchReader, waiting for a worker to decode it
+    struct ReadJob
+    {
+        uint32_t row = 0;
+        PooledBuffer data;
+    };
+
+    void decodeReadJob(BulkContext &ctx, ReadJob &job)
+    {
+        WorkerScratch &scratch = workerScratch(ctx);
+        IPFEntryView ent = ctx.index->getEntry(job.row);
+        IPF_TRACE_SCOPE_BYTES(Extract, ent.getFileSizeUncompressed());
+        std::string err;
+        StringRef name = ent.getDirectoryName();
+        if (!prepareOutputPath(*ctx.options, name, scratch, err))
+        {
+            ctx.addError(err);
+            return;
+        }
+
+        // Stored payloads are written straight from the read buffer
+        const PooledBuffer *file = &job.data;
+        if (!ent.shouldSkipDecompression())
+        {
+            if (!decodeFileData(ent, job.data.mutableSpan(), scratch.output, err, ctx.options->verify_crc))
+            {
+                ctx.addError(name.str() + ": " + err);
+                return;
+            }
+            file = &scratch.output;
+        }
+        else if (ctx.options->verify_crc && !verifyStoredBytes(job.data.span(), ent.getCrc32(), err))
+        {
+            ctx.addError(name.str() + ": " + err);
+            return;
+        }
+        if (!writeFileBytes(scratch.path, file->data(), file->size()))
+        {
+            ctx.addError("Failed to write " + scratch.path);
+            return;
+        }
+        finishEntry(ctx, ent, file->size());
+    }
+
+    // Bytes read but not decoded yet, and decode tasks still queued or running
+    struct ReadAhead
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        uint64_t bytes = 0;
+        size_t tasks = 0;
+
+        void add(uint64_t n)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bytes += n;
+            ++tasks;
+        }
+
+        void release(uint64_t n)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bytes -= n;
+                --tasks;
+            }
+            changed.notify_all();
+        }
+
+        // A payload bigger than the whole budget still goes through, alone
+        bool hasRoom(uint64_t n, uint64_t limit)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return bytes == 0 || bytes + n <= limit;
+        }
+
+        void waitForRoom(uint64_t n, uint64_t limit)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]()
+                         { return bytes == 0 || bytes + n <= limit; });
+        }
+
+        void waitIdle()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]()
+                         { return tasks == 0; });
+        }
+    };
+
+    // Reads go out in (container, file_pointer) order from this thread with the
+    // disk queue kept full; each finished payload is decoded and written on the
+    // pool while later reads are still in flight. Entries that are streamed
+    // (at least stream_threshold) take the regular per-entry path instead.
+    void extractWithBatchReader(BulkContext &ctx, size_t threads)
+    {
+        const BulkExtractOptions &options = *ctx.options;
+        const IPFIndex &index = *ctx.index;
+        BatchReader reader(options.read_queue_depth);
+        logInfo(std::string("Batched reads via ") + reader.getBackendName() + ", queue depth " +
+                std::to_string(reader.getQueueDepth()));
+
+        ReadAhead readAhead;
+        std::vector<std::shared_ptr<ReadJob>> inFlight(reader.getQueueDepth());
+        std::vector<size_t> freeSlots;
+        for (size_t i = inFlight.size(); i > 0; --i)
+            freeSlots.push_back(i - 1);
+        std::vector<ReadCompletion> done;
+
+        const int FILE_NOT_OPENED = -2;
+        std::vector<int> fileOf(index.containerCount(), FILE_NOT_OPENED);
+        std::vector<std::string> openErrors(index.containerCount());
+
+        ThreadPool pool(threads, SchedulingMode::SharedQueue); // FIFO keeps decoding in read order
+
+        auto dispatch = [&]()
+        {
+            for (auto &completion : done)
+            {
+                std::shared_ptr<ReadJob> job = std::move(inFlight[completion.tag]);
+                freeSlots.push_back(static_cast<size_t>(completion.tag));
+                uint64_t size = job->data.size();
+                if (!completion.ok)
+                {
+                    ctx.addError(index.getEntry(job->row).getDirectoryName().str() + ": " + completion.error);
+                    readAhead.release(size);
+                    continue;
+                }
+                pool.enqueue([&ctx, &readAhead, job, size]()
+                             {
+                    decodeReadJob(ctx, *job);
+                    job->data.release(); // back to the pool before the budget frees up
+                    readAhead.release(size); });
+            }
+            done.clear();
+        };
+
+        for (uint32_t row : *ctx.rows)
+        {
+            IPFEntryView ent = index.getEntry(row);
+            if (!ent.shouldSkipDecompression() && ent.getFileSizeUncompressed() >= options.stream_threshold)
+            {
+                readAhead.add(0);
+                pool.enqueue([&ctx, &readAhead, row]()
+                             {
+                    extractOne(ctx, ctx.index->getEntry(row), workerScratch(ctx));
+                    readAhead.release(0); });
+                continue;
+            }
+
+            uint32_t container = ent.getContainerId();
+            if (fileOf[container] == FILE_NOT_OPENED)
+                fileOf[container] = reader.addFile(index.getContainerInfo(container).path, openErrors[container]);
+            if (fileOf[container] < 0)
+            {
+                ctx.addError(ent.getDirectoryName().str() + ": " + openErrors[container]);
+                continue;
+            }
+
+            // Wait for a free slot and for room in the read-ahead budget. Reads in
+            // flight count against the budget, so hand those to the pool first.
+            uint64_t size = ent.getFileSizeCompressed();
+            while (freeSlots.empty() || !readAhead.hasRoom(size, options.read_ahead_bytes))
+            {
+                if (reader.pending() == 0)
+                {
+                    readAhead.waitForRoom(size, options.read_ahead_bytes);
+                    continue;
+                }
+                reader.collect(done, 1);
+                dispatch();
+            }
+
+            std::shared_ptr<ReadJob> job = std::make_shared<ReadJob>();
+            job->row = row;
+            job->data.resizeDiscard(static_cast<size_t>(size));
+            size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            inFlight[slot] = job;
+            readAhead.add(size);
+            reader.submit(fileOf[container], ent.getFilePointer(), job->data.data(), job->data.size(), slot);
+        }
+
+        while (reader.pending() > 0)
+        {
+            reader.collect(done, 1);
+            dispatch();
+        }
+        readAhead.waitIdle();
+    }
+
+    // Point every duplicate at the file written for the first row of its group
+    void linkDuplicates(BulkContext &ctx, const DedupReport &report)
+    {
+        WorkerScratch scratch;
+        std::string err;
+        for (auto &group : report.groups)
+        {
+            IPFEntryView first = ctx.index->getEntry(group.rows[0]);
+            bool haveSource = ctx.done[first.getRow()] && prepareOutputPath(*ctx.options, first.getDirectoryName(), scratch, err);
+            std::string source = scratch.path;
+
+            for (size_t i = 1; i < group.rows.size(); ++i)
+            {
+                IPFEntryView ent = ctx.index->getEntry(group.rows[i]);
+                StringRef name = ent.getDirectoryName();
+                if (!haveSource)
+                {
+                    ctx.addError(name.str() + ": duplicate of " + first.getDirectoryName().str() + ", which failed");
+                    continue;
+                }
+                if (!prepareOutputPath(*ctx.options, name, scratch, err))
+                {
+                    ctx.addError(err);
+                    continue;
+                }
+                // The same logical path in two containers: the file is already there
+                if (scratch.path != source && !linkOrCopyFile(source, scratch.path))
+                {
+                    ctx.addError("Failed to link " + scratch.path);
+                    continue;
+                }
+                ctx.entries.fetch_add(1, std::memory_order_relaxed);
+                ctx.bytes_out.fetch_add(ent.getFileSizeUncompressed(), std::memory_order_relaxed);
+                ++ctx.linked;
+            }
+        }
+    }
+}
+
+double BulkExtractStats::getEntriesPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(entries) / seconds : 0.0;
+}
+
+double BulkExtractStats::getMegabytesInPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(bytes_in) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+double BulkExtractStats::getMegabytesOutPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(bytes_out) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+std::string BulkExtractStats::toString() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "%llu entries (%llu failed) in %.2fs: %.0f entries/s, %.1f MB/s in, %.1f MB/s out",
+                  static_cast<unsigned long long>(entries), static_cast<unsigned long long>(failures), seconds,
+                  getEntriesPerSecond(), getMegabytesInPerSecond(), getMegabytesOutPerSecond());
+    if (linked == 0)
+        return buf;
+    return std::string(buf) + ", " + std::to_string(linked) + " linked";
+}
+
+void sortLargestFirst(const IPFIndex &index, std::vector<uint32_t> &rows)
+{
+    std::stable_sort(rows.begin(), rows.end(), [&index](uint32_t a, uint32_t b)
+                     { return index.getEntry(a).getFileSizeUncompressed() > index.getEntry(b).getFileSizeUncompressed(); });
+}
+
+void parallelForEntries(ThreadPool &pool, const IPFIndex &index, const std::vector<uint32_t> &rows,
+                        uint64_t grainBytes, const std::function<void(const IPFEntryView &)> &body)
+{
+    pool.parallelForWeighted(
+        rows.size(), [&](size_t i)
+        { return static_cast<uint64_t>(index.getEntry(rows[i]).getFileSizeUncompressed()) + 1; },
+        grainBytes, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                body(index.getEntry(rows[i])); });
+}
+
+std::vector<uint32_t> selectEntries(const IPFIndex &index, const std::string &pattern)
+{
+    std::vector<uint32_t> rows;
+    rows.reserve(index.size());
+    for (uint32_t i = 0; i < index.size(); ++i)
+        if (pattern.empty() || matchGlob(StringRef(pattern), index.getEntry(i).getDirectoryName()))
+            rows.push_back(i);
+    return rows;
+}
+
+std::vector<uint32_t> selectEntries(const PathIndex &paths, const std::string &pattern)
+{
+    std::vector<uint32_t> rows;
+    if (pattern.empty())
+    {
+        RowRange all = paths.getSorted();
+        rows.assign(all.begin(), all.end());
+    }
+    else
+        paths.glob(StringRef(pattern), rows);
+    return rows;
+}
+
+bool extractEntries(const IPFIndex &index, const std::vector<uint32_t> &rows,
+                    const BulkExtractOptions &options, BulkExtractStats &stats)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Duplicates are left out of the batches and linked once their original is on disk
+    DedupReport dedup;
+    std::vector<uint32_t> order;
+    if (options.dedup)
+    {
+        findDuplicates(index, rows, dedup);
+        logInfo("Dedup: " + dedup.toString());
+        std::vector<uint8_t> isCopy(index.size(), 0);
+        for (auto &group : dedup.groups)
+            for (size_t i = 1; i < group.rows.size(); ++i)
+                isCopy[group.rows[i]] = 1;
+        for (uint32_t row : rows)
+            if (!isCopy[row])
+                order.push_back(row);
+    }
+    else
+        order = rows;
+
+    // Sequential access per container: sort by (container, file_pointer)
+    std::sort(order.begin(), order.end(), [&index](uint32_t a, uint32_t b)
+              {
+        IPFEntryView ea = index.getEntry(a);
+        IPFEntryView eb = index.getEntry(b);
+        if (ea.getContainerId() != eb.getContainerId())
+            return ea.getContainerId() < eb.getContainerId();
+        return ea.getFilePointer() < eb.getFilePointer(); });
+
+    // Contiguous batches of about batch_bytes compressed input, never spanning containers
+    std::vector<Batch> batches;
+    size_t batchStart = 0;
+    uint64_t batchBytes = 0;
+    uint64_t batchWeight = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        IPFEntryView ent = index.getEntry(order[i]);
+        bool newContainer = i > batchStart && ent.getContainerId() != index.getEntry(order[i - 1]).getContainerId();
+        if (newContainer || (i > batchStart && batchBytes >= options.batch_bytes))
+        {
+            batches.push_back(Batch{batchStart, i, batchWeight});
+            batchStart = i;
+            batchBytes = 0;
+            batchWeight = 0;
+        }
+        batchBytes += ent.getFileSizeCompressed();
+        batchWeight += ent.getFileSizeUncompressed();
+    }
+    if (batchStart < order.size())
+        batches.push_back(Batch{batchStart, order.size(), batchWeight});
+
+    // Batches stay sequential inside a container; only their start order changes,
+    // so a 100 MB asset does not become the straggler at the very end.
+    if (options.largest_first)
+        std::stable_sort(batches.begin(), batches.end(), [](const Batch &a, const Batch &b)
+                         { return a.weight > b.weight; });
+
+    BulkContext ctx;
+    ctx.index = &index;
+    ctx.rows = &order;
+    ctx.options = &options;
+    ctx.call_id = next_call_id.fetch_add(1, std::memory_order_relaxed);
+    if (options.dedup)
+        ctx.done.assign(index.size(), 0);
+
+    size_t threads = options.thread_count ? options.thread_count : std::thread::hardware_concurrency();
+    if (options.batched_reads)
+    {
+        // Decode tasks are per entry, so one big container still keeps every thread busy
+        extractWithBatchReader(ctx, std::max<size_t>(1, std::min<size_t>(threads, order.size())));
+    }
+    else
+    {
+        // A batch is the unit of work here; more threads than batches would sit idle
+        threads = std::max<size_t>(1, std::min<size_t>(threads, std::max<size_t>(batches.size(), 1)));
+        ThreadPool pool(threads, SchedulingMode::WorkStealing);
+        pool.parallelFor(0, batches.size(), 1, [&ctx, &batches](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+                runBatch(ctx, batches[i]); });
+    }
+    if (options.dedup)
+        linkDuplicates(ctx, dedup);
+
+    stats.entries += ctx.entries.load();
+    stats.failures += ctx.failures.load();
+    stats.bytes_in += ctx.bytes_in.load();
+    stats.bytes_out += ctx.bytes_out.load();
+    stats.linked += ctx.linked;
+    stats.errors.insert(stats.errors.end(), ctx.errors.begin(), ctx.errors.end());
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    logInfo("Extracted " + stats.toString());
+    return ctx.failures.load() == 0;
+}
+
+bool extractAll(const IPFIndex &index, const BulkExtractOptions &options, BulkExtractStats &stats)
+{
+    return extractEntries(index, selectEntries(index, options.pattern), options, stats);
+}
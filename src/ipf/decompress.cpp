@@ -1,11 +1,90 @@
 #include "ipf/decompress.hpp"
+#include "ipf/buffer_pool.hpp"
+#include "ipf/fast_inflate.hpp"
+#include "ipf/trace.hpp"
 
 #include <zlib.h>
+#include <algorithm>
 #include <iostream>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
+namespace
+{
+    // One z_stream per thread, initialised once and recycled with inflateReset.
+    struct InflateState
+    {
+        z_stream zs;
+        bool ready = false;
+
+        InflateState()
+        {
+            zs.zalloc = Z_NULL;
+            zs.zfree = Z_NULL;
+            zs.opaque = Z_NULL;
+            zs.next_in = Z_NULL;
+            zs.avail_in = 0;
+            ready = inflateInit2(&zs, -MAX_WBITS) == Z_OK;
+        }
+
+        ~InflateState()
+        {
+            if (ready)
+                inflateEnd(&zs);
+        }
+
+        z_stream *acquire()
+        {
+            if (!ready)
+                return nullptr;
+            if (inflateReset(&zs) != Z_OK)
+                return nullptr;
+            return &zs;
+        }
+    };
+
+    InflateState &threadInflateState()
+    {
+        static thread_local InflateState state;
+        return state;
+    }
+
+    // Deflate counterpart; re-initialised only when the level changes.
+    struct DeflateState
+    {
+        z_stream zs;
+        bool ready = false;
+        int level = 0;
+
+        ~DeflateState()
+        {
+            if (ready)
+                deflateEnd(&zs);
+        }
+
+        z_stream *acquire(int wantedLevel)
+        {
+            if (ready && level == wantedLevel)
+                return deflateReset(&zs) == Z_OK ? &zs : nullptr;
+            if (ready)
+                deflateEnd(&zs);
+            zs.zalloc = Z_NULL;
+            zs.zfree = Z_NULL;
+            zs.opaque = Z_NULL;
+            ready = deflateInit2(&zs, wantedLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            level = wantedLevel;
+            return ready ? &zs : nullptr;
+        }
+    };
+
+    DeflateState &threadDeflateState()
+    {
+        static thread_local DeflateState state;
+        return state;
+    }
+}
+
 bool decompressZlib(const std::vector<uint8_t> &in, std::vector<uint8_t> &out, std::string &err)
 {
     if (in.empty())
@@ -13,50 +92,211 @@ bool decompressZlib(const std::vector<uint8_t> &in, std::vector<uint8_t> &out, s
         out.clear();
         return true;
     }
+    IPF_TRACE_SCOPE_BYTES(Inflate, in.size());
 
-    z_stream zs;
-    zs.zalloc = Z_NULL;
-    zs.zfree = Z_NULL;
-    zs.opaque = Z_NULL;
-    zs.next_in = const_cast<Bytef *>(in.data());
-    zs.avail_in = static_cast<uInt>(in.size());
-
-    // -MAX_WBITS to indicate raw deflate (no zlib header). Use MAX_WBITS for zlib header.
-    int ret = inflateInit2(&zs, -MAX_WBITS);
-    if (ret != Z_OK)
+    z_stream *zs = threadInflateState().acquire();
+    if (!zs)
     {
         err = "inflateInit2 failed";
         return false;
     }
+    zs->next_in = const_cast<Bytef *>(in.data());
+    zs->avail_in = static_cast<uInt>(in.size());
 
-    std::vector<uint8_t> buffer;
-    size_t out_capacity = std::max<size_t>(in.size() * 3, 1024);
-    buffer.resize(out_capacity);
-
-    zs.next_out = buffer.data();
-    zs.avail_out = static_cast<uInt>(buffer.size());
+    // The size is unknown here: grow a pooled buffer (no zero-fill) and copy once at the end
+    PooledBuffer buffer;
+    buffer.resizeDiscard(std::max<size_t>(in.size() * 3, 1024));
+    zs->next_out = buffer.data();
+    zs->avail_out = static_cast<uInt>(buffer.size());
 
     while (true)
     {
-        ret = inflate(&zs, Z_NO_FLUSH);
+        int ret = inflate(zs, Z_NO_FLUSH);
         if (ret == Z_STREAM_END)
             break;
         if (ret != Z_OK)
         {
-            inflateEnd(&zs);
             err = "inflate failed with code " + std::to_string(ret);
             return false;
         }
         // need more space
-        size_t used = buffer.size() - zs.avail_out;
+        size_t used = buffer.size() - zs->avail_out;
         buffer.resize(buffer.size() * 2);
-        zs.next_out = buffer.data() + used;
-        zs.avail_out = static_cast<uInt>(buffer.size() - used);
+        zs->next_out = buffer.data() + used;
+        zs->avail_out = static_cast<uInt>(buffer.size() - used);
+    }
+
+    size_t decompressed = buffer.size() - zs->avail_out;
+    out.assign(buffer.data(), buffer.data() + decompressed);
+    return true;
+}
+
+bool compressDeflate(ByteSpan in, std::vector<uint8_t> &out, int level, std::string &err)
+{
+    if (in.size > UINT32_MAX)
+    {
+        err = "deflate input larger than 4 GB";
+        return false;
     }
 
-    size_t decompressed = buffer.size() - zs.avail_out;
-    out.assign(buffer.begin(), buffer.begin() + decompressed);
+    z_stream *zs = threadDeflateState().acquire(level);
+    if (!zs)
+    {
+        err = "deflateInit2 failed";
+        return false;
+    }
+
+    // deflateBound is a hard upper limit, so one Z_FINISH call always completes
+    out.resize(deflateBound(zs, static_cast<uLong>(in.size)));
+    zs->next_in = const_cast<Bytef *>(in.data);
+    zs->avail_in = static_cast<uInt>(in.size);
+    zs->next_out = out.data();
+    zs->avail_out = static_cast<uInt>(out.size());
 
-    inflateEnd(&zs);
+    int ret = deflate(zs, Z_FINISH);
+    if (ret != Z_STREAM_END)
+    {
+        err = "deflate failed with code " + std::to_string(ret);
+        return false;
+    }
+    out.resize(zs->total_out);
     return true;
 }
+
+bool decompressZlibInto(ByteSpan in, uint8_t *out, size_t outSize, std::string &err)
+{
+    if (in.size > UINT32_MAX || outSize > UINT32_MAX)
+    {
+        err = "inflate input or output larger than 4 GB";
+        return false;
+    }
+
+    // One scope for both decoders: a stream the fast path gives up on is still
+    // one stream, and the failed attempt is part of what inflating it cost
+    IPF_TRACE_SCOPE_BYTES(Inflate, in.size);
+    if (isFastInflateEnabled())
+    {
+        if (fastInflate(in, out, outSize))
+            return true;
+        // Corrupt or unusual stream: zlib either decodes it or says what is wrong
+    }
+
+    z_stream *zs = threadInflateState().acquire();
+    if (!zs)
+    {
+        err = "inflateInit2 failed";
+        return false;
+    }
+
+    // zlib rejects a null next_out even when nothing is expected
+    uint8_t dummy = 0;
+    zs->next_in = const_cast<Bytef *>(in.data);
+    zs->avail_in = static_cast<uInt>(in.size);
+    zs->next_out = outSize ? out : &dummy;
+    zs->avail_out = static_cast<uInt>(outSize);
+
+    int ret = inflate(zs, Z_FINISH);
+    if (ret == Z_STREAM_END)
+    {
+        if (zs->total_out != outSize)
+        {
+            err = "inflate size mismatch: got " + std::to_string(zs->total_out) +
+                  " bytes, expected " + std::to_string(outSize);
+            return false;
+        }
+        return true;
+    }
+
+    if (ret == Z_BUF_ERROR || ret == Z_OK)
+    {
+        if (zs->avail_out == 0)
+            err = "inflate size mismatch: stream is larger than the expected " + std::to_string(outSize) + " bytes";
+        else
+            err = "inflate size mismatch: input ended after " + std::to_string(zs->total_out) +
+                  " bytes, expected " + std::to_string(outSize);
+        return false;
+    }
+
+    err = "inflate failed with code " + std::to_string(ret);
+    return false;
+}
+
+bool decompressZlibInto(ByteSpan in, std::vector<uint8_t> &out, size_t expectedSize, std::string &err)
+{
+    out.resize(expectedSize);
+    return decompressZlibInto(in, out.data(), expectedSize, err);
+}
+
+InflateStream::InflateStream() : zs(new z_stream())
+{
+    zs->zalloc = Z_NULL;
+    zs->zfree = Z_NULL;
+    zs->opaque = Z_NULL;
+    zs->next_in = Z_NULL;
+    zs->avail_in = 0;
+    ready = inflateInit2(zs.get(), -MAX_WBITS) == Z_OK;
+}
+
+InflateStream::~InflateStream()
+{
+    if (ready)
+        inflateEnd(zs.get());
+}
+
+bool InflateStream::reset(std::string &err)
+{
+    if (!ready || inflateReset(zs.get()) != Z_OK)
+    {
+        err = "inflateInit2 failed";
+        return false;
+    }
+    return true;
+}
+
+bool InflateStream::write(ByteSpan in, uint8_t *window, size_t windowSize, const ByteSink &sink, bool &finished, std::string &err)
+{
+    finished = false;
+    zs->next_in = const_cast<Bytef *>(in.data);
+    zs->avail_in = static_cast<uInt>(in.size);
+
+    // Drain until the input piece is consumed and the window was not filled to the brim
+    do
+    {
+        zs->next_out = window;
+        zs->avail_out = static_cast<uInt>(windowSize);
+
+        int ret;
+        {
+            // Only the inflate call: the sink below may be writing to disk. A
+            // piece can take several passes, so count what this one consumed.
+            IPF_TRACE_SCOPE_AS(inflate_scope, Inflate);
+            uInt availIn = zs->avail_in;
+            ret = inflate(zs.get(), Z_NO_FLUSH);
+            IPF_TRACE_SET_BYTES(inflate_scope, availIn - zs->avail_in);
+        }
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        {
+            err = "inflate failed with code " + std::to_string(ret);
+            return false;
+        }
+
+        size_t produced = windowSize - zs->avail_out;
+        if (produced && !sink(window, produced))
+        {
+            err = "Output sink rejected data";
+            return false;
+        }
+
+        if (ret == Z_STREAM_END)
+        {
+            finished = true;
+            return true;
+        }
+        if (ret == Z_BUF_ERROR && produced == 0)
+            break; // needs more input
+    } while (zs->avail_in > 0 || zs->avail_out == 0);
+
+    return true;
+}
+
+uint64_t InflateStream::totalOut() const { return zs->total_out; }
@@ -0,0 +1,152 @@
+#include "ipf/dedup.hpp"
+#include "ipf/ipf_container.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const size_t COMPARE_CHUNK_SIZE = 1u << 20;
+
+    struct DedupKey
+    {
+        uint32_t crc32;
+        uint32_t size_compressed;
+        uint32_t size_uncompressed;
+        bool stored;
+
+        bool operator<(const DedupKey &o) const
+        {
+            if (crc32 != o.crc32)
+                return crc32 < o.crc32;
+            if (size_compressed != o.size_compressed)
+                return size_compressed < o.size_compressed;
+            if (size_uncompressed != o.size_uncompressed)
+                return size_uncompressed < o.size_uncompressed;
+            return stored < o.stored;
+        }
+        bool operator==(const DedupKey &o) const { return !(*this < o) && !(o < *this); }
+    };
+
+    DedupKey makeKey(const IPFEntryView &ent)
+    {
+        return DedupKey{ent.getCrc32(), ent.getFileSizeCompressed(), ent.getFileSizeUncompressed(),
+                        ent.shouldSkipDecompression()};
+    }
+
+    // Mapped containers compare in place; anything else goes through two chunk buffers.
+    // Bytes that cannot be read never confirm a match.
+    bool sameStoredBytes(const IPFEntryView &a, const IPFEntryView &b, std::vector<uint8_t> &bufA,
+                         std::vector<uint8_t> &bufB)
+    {
+        if (!a.getContainer() || !b.getContainer())
+            return false;
+        const IPFContainer &ca = *a.getContainer();
+        const IPFContainer &cb = *b.getContainer();
+        if (&ca == &cb && a.getFilePointer() == b.getFilePointer())
+            return true;
+
+        uint32_t size = a.getFileSizeCompressed();
+        ByteSpan sa, sb;
+        if (ca.getSpan(a.getFilePointer(), size, sa) && cb.getSpan(b.getFilePointer(), size, sb))
+            return std::memcmp(sa.data, sb.data, size) == 0;
+
+        std::string err;
+        for (uint32_t done = 0; done < size;)
+        {
+            size_t chunk = std::min<size_t>(COMPARE_CHUNK_SIZE, size - done);
+            bufA.resize(chunk);
+            bufB.resize(chunk);
+            if (!ca.readBytes(a.getFilePointer() + done, bufA.data(), chunk, err) ||
+                !cb.readBytes(b.getFilePointer() + done, bufB.data(), chunk, err) ||
+                std::memcmp(bufA.data(), bufB.data(), chunk) != 0)
+                return false;
+            done += static_cast<uint32_t>(chunk);
+        }
+        return true;
+    }
+}
+
+std::string DedupReport::toString() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "%llu duplicates of %llu entries in %zu groups, %.1f MB in / %.1f MB out saved, "
+                  "%llu false matches, %.2fs",
+                  static_cast<unsigned long long>(duplicate_entries), static_cast<unsigned long long>(candidate_entries),
+                  groups.size(), static_cast<double>(saved_bytes_in) / (1024.0 * 1024.0),
+                  static_cast<double>(saved_bytes_out) / (1024.0 * 1024.0),
+                  static_cast<unsigned long long>(false_matches), seconds);
+    return buf;
+}
+
+void findDuplicates(const IPFIndex &index, const std::vector<uint32_t> &rows, DedupReport &report, bool confirm)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::pair<DedupKey, uint32_t>> keyed;
+    keyed.reserve(rows.size());
+    for (uint32_t row : rows)
+    {
+        IPFEntryView ent = index.getEntry(row);
+        if (ent.getFileSizeCompressed() == 0)
+            continue;
+        keyed.push_back(std::make_pair(makeKey(ent), row));
+    }
+    report.candidate_entries += keyed.size();
+
+    // Sorting by key then row keeps the first row of each group deterministic
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<uint8_t> bufA, bufB;
+    std::vector<uint32_t> pending, rest;
+    for (size_t begin = 0; begin < keyed.size();)
+    {
+        size_t end = begin + 1;
+        while (end < keyed.size() && keyed[end].first == keyed[begin].first)
+            ++end;
+        if (end - begin < 2)
+        {
+            begin = end;
+            continue;
+        }
+
+        pending.clear();
+        for (size_t i = begin; i < end; ++i)
+            pending.push_back(keyed[i].second);
+
+        // A CRC collision splits the candidates; each pass peels off one confirmed group
+        while (pending.size() > 1)
+        {
+            DedupGroup group;
+            group.rows.push_back(pending[0]);
+            rest.clear();
+            IPFEntryView first = index.getEntry(pending[0]);
+            for (size_t i = 1; i < pending.size(); ++i)
+            {
+                if (!confirm || sameStoredBytes(first, index.getEntry(pending[i]), bufA, bufB))
+                    group.rows.push_back(pending[i]);
+                else
+                    rest.push_back(pending[i]);
+            }
+            // Only on the first pass: later passes regroup rows already counted
+            if (pending.size() == end - begin)
+                report.false_matches += rest.size();
+
+            if (group.rows.size() > 1)
+            {
+                uint64_t copies = group.rows.size() - 1;
+                report.duplicate_entries += copies;
+                report.saved_bytes_in += copies * first.getFileSizeCompressed();
+                report.saved_bytes_out += copies * first.getFileSizeUncompressed();
+                report.groups.push_back(std::move(group));
+            }
+            pending.swap(rest);
+        }
+        begin = end;
+    }
+
+    report.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
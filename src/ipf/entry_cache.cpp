@@ -0,0 +1,140 @@
+#include "ipf/entry_cache.hpp"
+#include "ipf/ipf_reader.hpp"
+
+#include <cstdio>
+
+double EntryCacheStats::getHitRate() const
+{
+    uint64_t total = hits + misses;
+    return total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+}
+
+std::string EntryCacheStats::toString() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "%zu entries, %.1f / %.1f MB, %llu hits, %llu misses (%.1f%%), %llu evictions, %llu rejected",
+                  entries, bytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0),
+                  static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses),
+                  getHitRate() * 100.0, static_cast<unsigned long long>(evictions),
+                  static_cast<unsigned long long>(rejected));
+    return buf;
+}
+
+bool EntryCache::get(const IPFEntryView &ent, SharedBytes &out, std::string &err, bool verifyCrc)
+{
+    static thread_local std::vector<uint8_t> scratch;
+    const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+
+    // Empty entries share their pointer with the next entry; never key them
+    if (ent.getFileSizeCompressed() == 0)
+    {
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        if (!extractFileData(ent, *data, scratch, err, verifyCrc))
+            return false;
+        out = std::move(data);
+        return true;
+    }
+
+    if (lookup(container, ent.getFilePointer(), out))
+        return true;
+
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    if (!extractFileData(ent, *data, scratch, err, verifyCrc))
+        return false;
+    out = insert(container, ent.getFilePointer(), std::move(data));
+    return true;
+}
+
+bool EntryCache::lookup(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer, SharedBytes &out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = map.find(Key{container.get(), filePointer});
+    if (it == map.end())
+    {
+        ++misses;
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    out = it->second->data;
+    ++hits;
+    return true;
+}
+
+bool EntryCache::contains(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return map.count(Key{container.get(), filePointer}) != 0;
+}
+
+SharedBytes EntryCache::insert(const std::shared_ptr<IPFContainer> &container, uint32_t filePointer, SharedBytes data)
+{
+    size_t charge = chargeOf(*data);
+    Key key{container.get(), filePointer};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = map.find(key);
+    if (it != map.end())
+    {
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->data;
+    }
+    if (charge > budget)
+    {
+        ++rejected;
+        return data;
+    }
+
+    lru.push_front(Node{key, container, data, charge});
+    map.emplace(key, lru.begin());
+    used += charge;
+    evictLocked();
+    return data;
+}
+
+void EntryCache::evictLocked()
+{
+    while (used > budget && !lru.empty())
+    {
+        Node &victim = lru.back();
+        used -= victim.charge;
+        map.erase(victim.key);
+        lru.pop_back();
+        ++evictions;
+    }
+}
+
+void EntryCache::setBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = budgetBytes;
+    evictLocked();
+}
+
+size_t EntryCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+void EntryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    map.clear();
+    lru.clear();
+    used = 0;
+}
+
+EntryCacheStats EntryCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    EntryCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.rejected = rejected;
+    stats.entries = map.size();
+    stats.bytes = used;
+    stats.budget = budget;
+    return stats;
+}
@@ -0,0 +1,131 @@
+#include "ipf/entry_stream.hpp"
+#include "ipf/crc32.hpp"
+#include "ipf/decrypt.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/trace.hpp"
+#include "ipf/verify.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    bool streamPayload(const IPFContainer &container, uint32_t filePointer, uint32_t sizeCompressed,
+                       uint32_t sizeUncompressed, uint32_t crc32, bool stored, const ByteSink &sink,
+                       std::string &err, size_t chunkSize, bool verifyCrc)
+    {
+        if (chunkSize == 0)
+            chunkSize = DEFAULT_STREAM_CHUNK_SIZE;
+        if (sizeCompressed == 0)
+            return true;
+
+        std::vector<uint8_t> input(std::min<size_t>(chunkSize, sizeCompressed));
+        uint32_t crc = 0; // running CRC of the stored bytes; cheap enough to always compute
+
+        // Stored entries: pass the bytes through, straight from the mapping when there is one
+        if (stored)
+        {
+            for (uint64_t done = 0; done < sizeCompressed;)
+            {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(chunkSize, sizeCompressed - done));
+                ByteSpan piece;
+                if (!container.getSpan(filePointer + done, n, piece))
+                {
+                    if (!container.readBytes(filePointer + done, input.data(), n, err))
+                        return false;
+                    piece = ByteSpan(input.data(), n);
+                }
+                crc = crc32Update(crc, piece.data, piece.size);
+                if (!sink(piece.data, piece.size))
+                {
+                    err = "Output sink rejected data";
+                    return false;
+                }
+                done += n;
+            }
+            return !verifyCrc || checkStoredCrc(crc32, crc, err);
+        }
+
+        std::vector<uint8_t> window(std::max<size_t>(std::min<size_t>(chunkSize, sizeUncompressed), 1));
+        IPFCipher cipher;
+        InflateStream inflater;
+        if (!inflater.reset(err))
+            return false;
+
+        // Keep reading after the deflate end only when the CRC needs the trailing bytes
+        bool finished = false;
+        for (uint64_t done = 0; done < sizeCompressed && (!finished || verifyCrc);)
+        {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(chunkSize, sizeCompressed - done));
+            if (!container.readBytes(filePointer + done, input.data(), n, err))
+                return false;
+            crc = crc32Update(crc, input.data(), n);
+            done += n;
+            if (finished)
+                continue;
+            cipher.update(input.data(), n);
+            if (!inflater.write(ByteSpan(input.data(), n), window.data(), window.size(), sink, finished, err))
+                return false;
+        }
+
+        if (verifyCrc && !checkStoredCrc(crc32, crc, err))
+            return false;
+        if (!finished)
+        {
+            err = "inflate size mismatch: input ended after " + std::to_string(inflater.totalOut()) +
+                  " bytes, expected " + std::to_string(sizeUncompressed);
+            return false;
+        }
+        if (inflater.totalOut() != sizeUncompressed)
+        {
+            err = "inflate size mismatch: got " + std::to_string(inflater.totalOut()) +
+                  " bytes, expected " + std::to_string(sizeUncompressed);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool extractFileStream(const IPFContainer &container, const IPFFileTable &ent, const ByteSink &sink,
+                       std::string &err, size_t chunkSize, bool verifyCrc)
+{
+    return streamPayload(container, ent.file_pointer, ent.file_size_compressed, ent.file_size_uncompressed,
+                         ent.crc32, ent.shouldSkipDecompression(), sink, err, chunkSize, verifyCrc);
+}
+
+bool extractFileStream(const IPFEntryView &ent, const ByteSink &sink, std::string &err, size_t chunkSize,
+                       bool verifyCrc)
+{
+    const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+    if (!container)
+    {
+        err = "Container not open: " + ent.getFilePath();
+        return false;
+    }
+    return streamPayload(*container, ent.getFilePointer(), ent.getFileSizeCompressed(), ent.getFileSizeUncompressed(),
+                         ent.getCrc32(), ent.shouldSkipDecompression(), sink, err, chunkSize, verifyCrc);
+}
+
+bool extractFileToPath(const IPFEntryView &ent, const std::string &outPath, std::string &err, size_t chunkSize,
+                       bool verifyCrc)
+{
+    FILE *f = std::fopen(outPath.c_str(), "wb");
+    if (!f)
+    {
+        err = "Failed to create " + outPath;
+        return false;
+    }
+
+    bool ok = extractFileStream(ent, [f](const uint8_t *data, size_t size)
+                                {
+                                    IPF_TRACE_SCOPE_BYTES(Write, size);
+                                    return std::fwrite(data, 1, size, f) == size; },
+                                err, chunkSize, verifyCrc);
+    if (std::fclose(f) != 0 && ok)
+    {
+        err = "Failed to write " + outPath;
+        ok = false;
+    }
+    return ok;
+}
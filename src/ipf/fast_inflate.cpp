@@ -0,0 +1,627 @@
+#include "ipf/fast_inflate.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IPF_INFLATE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define IPF_INFLATE_NEON 1 // baseline on arm64, no runtime check needed
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Decode table entry, 32 bits:
+    //   bits 0-7   bits taken by the code (the main table bits for a subtable link)
+    //   bits 8-12  extra bits that follow the code (index bits for a subtable link)
+    //   bit  13    link: the value is where the subtable starts
+    //   bit  14    end of block when the value is 0, invalid code otherwise
+    //   bit  15    literal
+    //   bits 16-31 literal byte, base length, base distance or subtable start
+    const uint32_t ENTRY_SUBTABLE = 1u << 13;
+    const uint32_t ENTRY_EXCEPTIONAL = 1u << 14;
+    const uint32_t ENTRY_LITERAL = 1u << 15;
+    const uint32_t ENTRY_END_OF_BLOCK = ENTRY_EXCEPTIONAL;
+    const uint32_t ENTRY_INVALID = ENTRY_EXCEPTIONAL | (1u << 16);
+
+    const unsigned MAX_CODE_LENGTH = 15;
+    const unsigned LITLEN_SYMBOLS = 288; // 286 and 287 only appear in the fixed code
+    const unsigned DIST_SYMBOLS = 32;    // 30 and 31 likewise
+    const unsigned PRECODE_SYMBOLS = 19;
+
+    const unsigned LITLEN_TABLE_BITS = 10;
+    const unsigned DIST_TABLE_BITS = 8;
+    const unsigned PRECODE_TABLE_BITS = 7;
+    // Main table plus the worst case of subtables for each root size (zlib's enough.c)
+    const size_t LITLEN_TABLE_SIZE = 1334;
+    const size_t DIST_TABLE_SIZE = 402;
+    const size_t PRECODE_TABLE_SIZE = 1u << PRECODE_TABLE_BITS;
+
+    // Every match copy may write this far past its end; the fast path is only
+    // taken while that much room is left in the output.
+    const size_t COPY_SLACK = 32;
+
+    const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    const uint8_t PRECODE_ORDER[PRECODE_SYMBOLS] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    inline uint64_t loadLe64(const uint8_t *p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    inline uint32_t reverseBits(uint32_t code, unsigned length)
+    {
+        uint32_t r = 0;
+        for (unsigned i = 0; i < length; ++i, code >>= 1)
+            r = (r << 1) | (code & 1u);
+        return r;
+    }
+
+    // Canonical Huffman decode table for lengths[0..symbolCount). Codes up to
+    // tableBits long are replicated through the main table; longer ones go to
+    // subtables linked from the main entry of their first tableBits bits.
+    // Over-subscribed codes are rejected, and so are incomplete ones unless
+    // allowIncomplete and the code is a single one-bit code (as zlib allows for
+    // literal/length and distance codes).
+    bool buildDecodeTable(const uint8_t *lengths, unsigned symbolCount, const uint32_t *symbolEntries,
+                          unsigned tableBits, bool allowIncomplete, uint32_t *table, size_t capacity)
+    {
+        unsigned count[MAX_CODE_LENGTH + 1] = {};
+        for (unsigned s = 0; s < symbolCount; ++s)
+            ++count[lengths[s]];
+        count[0] = 0;
+
+        unsigned maxLength = 0;
+        int left = 1;
+        for (unsigned len = 1; len <= MAX_CODE_LENGTH; ++len)
+        {
+            left = (left << 1) - static_cast<int>(count[len]);
+            if (left < 0)
+                return false;
+            if (count[len])
+                maxLength = len;
+        }
+
+        const size_t mainSize = static_cast<size_t>(1) << tableBits;
+        for (size_t i = 0; i < mainSize; ++i)
+            table[i] = ENTRY_INVALID;
+        if (maxLength == 0)
+            return true; // no codes at all, every lookup is invalid
+        if (left > 0 && !(allowIncomplete && maxLength == 1))
+            return false;
+
+        unsigned offsets[MAX_CODE_LENGTH + 2] = {};
+        for (unsigned len = 1; len <= MAX_CODE_LENGTH; ++len)
+            offsets[len + 1] = offsets[len] + count[len];
+        uint16_t sorted[LITLEN_SYMBOLS];
+        for (unsigned s = 0; s < symbolCount; ++s)
+            if (lengths[s])
+                sorted[offsets[lengths[s]]++] = static_cast<uint16_t>(s);
+
+        unsigned remaining[MAX_CODE_LENGTH + 1];
+        std::memcpy(remaining, count, sizeof(count));
+        size_t next = mainSize; // first free subtable slot
+        size_t subStart = 0;
+        unsigned subBits = 0;
+        uint32_t currentPrefix = ~0u;
+        uint32_t code = 0; // canonical code, first bit most significant
+        unsigned index = 0;
+        for (unsigned len = 1; len <= maxLength; ++len, code <<= 1)
+        {
+            for (unsigned k = 0; k < count[len]; ++k, ++code, --remaining[len])
+            {
+                uint32_t entry = symbolEntries[sorted[index++]];
+                uint32_t reversed = reverseBits(code, len); // deflate sends codes first bit first
+                if (len <= tableBits)
+                {
+                    for (size_t i = reversed; i < mainSize; i += static_cast<size_t>(1) << len)
+                        table[i] = entry | len;
+                    continue;
+                }
+
+                uint32_t prefix = reversed & static_cast<uint32_t>(mainSize - 1);
+                if (prefix != currentPrefix)
+                {
+                    // Canonical order keeps codes with the same first bits together:
+                    // size the subtable for all of them that are still to come.
+                    subBits = len - tableBits;
+                    int room = 1 << subBits;
+                    while (subBits + tableBits < maxLength)
+                    {
+                        room -= static_cast<int>(remaining[subBits + tableBits]);
+                        if (room <= 0)
+                            break;
+                        ++subBits;
+                        room <<= 1;
+                    }
+                    subStart = next;
+                    next += static_cast<size_t>(1) << subBits;
+                    if (next > capacity)
+                        return false;
+                    for (size_t i = subStart; i < next; ++i)
+                        table[i] = ENTRY_INVALID;
+                    table[prefix] = ENTRY_SUBTABLE | (static_cast<uint32_t>(subStart) << 16) | (subBits << 8) | tableBits;
+                    currentPrefix = prefix;
+                }
+                unsigned subLength = len - tableBits;
+                for (size_t i = reversed >> tableBits; i < (static_cast<size_t>(1) << subBits); i += static_cast<size_t>(1) << subLength)
+                    table[subStart + i] = entry | subLength;
+            }
+        }
+        return true;
+    }
+
+    // Symbol entries (without the code length) and the fixed-code tables, built once.
+    struct StaticTables
+    {
+        uint32_t litlen_symbols[LITLEN_SYMBOLS];
+        uint32_t dist_symbols[DIST_SYMBOLS];
+        uint32_t precode_symbols[PRECODE_SYMBOLS];
+        uint32_t fixed_litlen[LITLEN_TABLE_SIZE];
+        uint32_t fixed_dist[DIST_TABLE_SIZE];
+        bool ready = false;
+
+        StaticTables()
+        {
+            for (unsigned s = 0; s < 256; ++s)
+                litlen_symbols[s] = ENTRY_LITERAL | (s << 16);
+            litlen_symbols[256] = ENTRY_END_OF_BLOCK;
+            for (unsigned s = 257; s < LITLEN_SYMBOLS; ++s)
+                litlen_symbols[s] = s < 286 ? (static_cast<uint32_t>(LENGTH_BASE[s - 257]) << 16) | (LENGTH_EXTRA[s - 257] << 8)
+                                            : ENTRY_INVALID;
+            for (unsigned s = 0; s < DIST_SYMBOLS; ++s)
+                dist_symbols[s] = s < 30 ? (static_cast<uint32_t>(DIST_BASE[s]) << 16) | (DIST_EXTRA[s] << 8) : ENTRY_INVALID;
+            for (unsigned s = 0; s < PRECODE_SYMBOLS; ++s)
+                precode_symbols[s] = s << 16;
+
+            uint8_t lengths[LITLEN_SYMBOLS];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            ready = buildDecodeTable(lengths, LITLEN_SYMBOLS, litlen_symbols, LITLEN_TABLE_BITS, false, fixed_litlen,
+                                     LITLEN_TABLE_SIZE);
+            std::memset(lengths, 5, DIST_SYMBOLS);
+            ready = ready && buildDecodeTable(lengths, DIST_SYMBOLS, dist_symbols, DIST_TABLE_BITS, false, fixed_dist,
+                                              DIST_TABLE_SIZE);
+        }
+    };
+
+    const StaticTables &staticTables()
+    {
+        static const StaticTables tables;
+        return tables;
+    }
+
+    // Match copy for periods shorter than a word: build one word of the pattern
+    // byte by byte, then store it at every multiple of the period.
+    inline void copyShortPeriod(uint8_t *dst, size_t distance, size_t length)
+    {
+        const uint8_t *src = dst - distance;
+        for (size_t i = 0; i < 8; ++i)
+            dst[i] = src[i];
+        size_t step = 8 - 8 % distance;
+        uint64_t pattern;
+        std::memcpy(&pattern, dst, 8);
+        for (uint8_t *p = dst + step, *end = dst + length; p < end; p += step)
+            std::memcpy(p, &pattern, 8);
+    }
+
+    // Chunked copies are safe once the distance is at least the chunk size:
+    // each load only sees bytes that are already final.
+    struct WordCopy
+    {
+        static inline void copy(uint8_t *dst, size_t distance, size_t length)
+        {
+            if (distance < 8)
+            {
+                copyShortPeriod(dst, distance, length);
+                return;
+            }
+            const uint8_t *src = dst - distance;
+            uint8_t *end = dst + length;
+            do
+            {
+                uint64_t word;
+                std::memcpy(&word, src, 8);
+                std::memcpy(dst, &word, 8);
+                src += 8;
+                dst += 8;
+            } while (dst < end);
+        }
+    };
+
+#if defined(IPF_INFLATE_X86)
+    struct Sse2Copy
+    {
+        __attribute__((target("sse2"))) static inline void copy(uint8_t *dst, size_t distance, size_t length)
+        {
+            if (distance < 16)
+            {
+                WordCopy::copy(dst, distance, length);
+                return;
+            }
+            const uint8_t *src = dst - distance;
+            uint8_t *end = dst + length;
+            do
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+                src += 16;
+                dst += 16;
+            } while (dst < end);
+        }
+    };
+
+    struct Avx2Copy
+    {
+        __attribute__((target("avx2"))) static inline void copy(uint8_t *dst, size_t distance, size_t length)
+        {
+            if (distance < 32)
+            {
+                Sse2Copy::copy(dst, distance, length);
+                return;
+            }
+            const uint8_t *src = dst - distance;
+            uint8_t *end = dst + length;
+            do
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)));
+                src += 32;
+                dst += 32;
+            } while (dst < end);
+        }
+    };
+#endif
+
+#if defined(IPF_INFLATE_NEON)
+    struct NeonCopy
+    {
+        static inline void copy(uint8_t *dst, size_t distance, size_t length)
+        {
+            if (distance < 16)
+            {
+                WordCopy::copy(dst, distance, length);
+                return;
+            }
+            const uint8_t *src = dst - distance;
+            uint8_t *end = dst + length;
+            do
+            {
+                vst1q_u8(dst, vld1q_u8(src));
+                src += 16;
+                dst += 16;
+            } while (dst < end);
+        }
+    };
+#endif
+
+    // One whole-buffer decode. Copier supplies the match copy; the rest is the
+    // same for every variant and picks up the instruction set of the entry
+    // point it is flattened into.
+    template <class Copier>
+    class Inflater
+    {
+    public:
+        Inflater(ByteSpan input, uint8_t *output, size_t outputSize)
+            : in(input.data), in_end(input.data + input.size), out_begin(output), out(output), out_end(output + outputSize)
+        {
+        }
+
+        bool run()
+        {
+            const StaticTables &fixed = staticTables();
+            if (!fixed.ready)
+                return false;
+
+            bool last = false;
+            while (!last)
+            {
+                refill();
+                if (isTruncated())
+                    return false;
+                last = takeBits(1) != 0;
+                unsigned type = takeBits(2);
+                bool ok = false;
+                if (type == 0)
+                    ok = copyStoredBlock();
+                else if (type == 1)
+                    ok = decodeBlock(fixed.fixed_litlen, fixed.fixed_dist);
+                else if (type == 2)
+                    ok = readDynamicTables() && decodeBlock(litlen_table, dist_table);
+                if (!ok)
+                    return false;
+            }
+            return out == out_end && !isTruncated();
+        }
+
+    private:
+        // Leaves 56 to 63 valid bits. Past the end of the input it shifts in zero
+        // bytes and counts them; consuming any of those means the input was truncated.
+        void refill()
+        {
+            if (in_end - in >= 8)
+            {
+                // Bits above bitsleft already hold the next input bytes, so OR-ing
+                // the word in again is harmless; only whole bytes are counted.
+                bitbuf |= loadLe64(in) << bitsleft;
+                in += (63 - bitsleft) >> 3;
+                bitsleft |= 56;
+                return;
+            }
+            while (bitsleft < 56)
+            {
+                uint64_t byte = 0;
+                if (in < in_end)
+                    byte = *in++;
+                else
+                    ++overread;
+                bitbuf |= byte << bitsleft;
+                bitsleft += 8;
+            }
+        }
+
+        bool isTruncated() const { return overread * 8 > bitsleft; }
+
+        void dropBits(unsigned n)
+        {
+            bitbuf >>= n;
+            bitsleft -= n;
+        }
+
+        uint32_t takeBits(unsigned n)
+        {
+            uint32_t v = static_cast<uint32_t>(bitbuf & ((static_cast<uint64_t>(1) << n) - 1));
+            dropBits(n);
+            return v;
+        }
+
+        // At most MAX_CODE_LENGTH bits
+        uint32_t decodeSymbol(const uint32_t *table, unsigned tableBits)
+        {
+            uint32_t entry = table[bitbuf & ((1u << tableBits) - 1)];
+            if (entry & ENTRY_SUBTABLE)
+            {
+                dropBits(tableBits);
+                entry = table[(entry >> 16) + (bitbuf & ((1u << ((entry >> 8) & 31)) - 1))];
+            }
+            dropBits(entry & 0xFF);
+            return entry;
+        }
+
+        // Base value plus the extra bits that follow the code
+        uint32_t entryValue(uint32_t entry) { return (entry >> 16) + takeBits((entry >> 8) & 31); }
+
+        bool copyStoredBlock()
+        {
+            // Align to a byte and give the whole bytes still buffered back to the input
+            dropBits(bitsleft & 7);
+            size_t buffered = bitsleft >> 3;
+            if (buffered < overread)
+                return false;
+            in -= buffered - overread;
+            overread = 0;
+            bitbuf = 0;
+            bitsleft = 0;
+
+            if (in_end - in < 4)
+                return false;
+            size_t len = in[0] | (in[1] << 8);
+            size_t nlen = in[2] | (in[3] << 8);
+            in += 4;
+            if (len != (~nlen & 0xFFFF) || static_cast<size_t>(in_end - in) < len || static_cast<size_t>(out_end - out) < len)
+                return false;
+            std::memcpy(out, in, len);
+            in += len;
+            out += len;
+            return true;
+        }
+
+        bool readDynamicTables()
+        {
+            const StaticTables &tables = staticTables();
+            refill();
+            unsigned litlenCount = takeBits(5) + 257;
+            unsigned distCount = takeBits(5) + 1;
+            unsigned precodeCount = takeBits(4) + 4;
+            if (litlenCount > 286 || distCount > 30)
+                return false;
+
+            uint8_t precodeLengths[PRECODE_SYMBOLS] = {};
+            for (unsigned i = 0; i < precodeCount; ++i)
+            {
+                refill();
+                precodeLengths[PRECODE_ORDER[i]] = static_cast<uint8_t>(takeBits(3));
+            }
+            uint32_t precode[PRECODE_TABLE_SIZE];
+            if (!buildDecodeTable(precodeLengths, PRECODE_SYMBOLS, tables.precode_symbols, PRECODE_TABLE_BITS, false,
+                                  precode, PRECODE_TABLE_SIZE))
+                return false;
+
+            uint8_t lengths[286 + 30];
+            unsigned total = litlenCount + distCount;
+            for (unsigned i = 0; i < total;)
+            {
+                refill(); // 7 bits of code plus up to 7 extra
+                if (isTruncated())
+                    return false;
+                uint32_t entry = decodeSymbol(precode, PRECODE_TABLE_BITS);
+                if (entry & ENTRY_EXCEPTIONAL)
+                    return false;
+                unsigned symbol = entry >> 16;
+                if (symbol < 16)
+                {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                uint8_t value = 0;
+                unsigned repeat;
+                if (symbol == 16)
+                {
+                    if (i == 0)
+                        return false;
+                    value = lengths[i - 1];
+                    repeat = 3 + takeBits(2);
+                }
+                else if (symbol == 17)
+                    repeat = 3 + takeBits(3);
+                else
+                    repeat = 11 + takeBits(7);
+                if (repeat > total - i)
+                    return false;
+                std::memset(lengths + i, value, repeat);
+                i += repeat;
+            }
+            if (lengths[256] == 0)
+                return false; // no end-of-block code
+
+            return buildDecodeTable(lengths, litlenCount, tables.litlen_symbols, LITLEN_TABLE_BITS, true, litlen_table,
+                                    LITLEN_TABLE_SIZE) &&
+                   buildDecodeTable(lengths + litlenCount, distCount, tables.dist_symbols, DIST_TABLE_BITS, true,
+                                    dist_table, DIST_TABLE_SIZE);
+        }
+
+        bool decodeBlock(const uint32_t *litlen, const uint32_t *dist)
+        {
+            for (;;)
+            {
+                // One refill covers a whole length/distance pair: 15 + 5 + 15 + 13 bits
+                refill();
+                if (isTruncated())
+                    return false;
+                uint32_t entry = decodeSymbol(litlen, LITLEN_TABLE_BITS);
+                if (entry & ENTRY_LITERAL)
+                {
+                    // Text is mostly literals: a second code still fits in the same refill
+                    if (out == out_end)
+                        return false;
+                    *out++ = static_cast<uint8_t>(entry >> 16);
+                    entry = decodeSymbol(litlen, LITLEN_TABLE_BITS);
+                    if (entry & ENTRY_LITERAL)
+                    {
+                        if (out == out_end)
+                            return false;
+                        *out++ = static_cast<uint8_t>(entry >> 16);
+                        continue;
+                    }
+                    refill(); // the pair needs up to 33 more bits
+                }
+                if (entry & ENTRY_EXCEPTIONAL)
+                    return (entry >> 16) == 0; // end of block, or an invalid code
+                size_t length = entryValue(entry);
+
+                entry = decodeSymbol(dist, DIST_TABLE_BITS);
+                if (entry & ENTRY_EXCEPTIONAL)
+                    return false;
+                size_t distance = entryValue(entry);
+
+                size_t room = static_cast<size_t>(out_end - out);
+                if (distance > static_cast<size_t>(out - out_begin) || length > room)
+                    return false;
+                if (room - length >= COPY_SLACK)
+                {
+                    Copier::copy(out, distance, length);
+                    out += length;
+                }
+                else
+                {
+                    // Near the end of the output: exact byte copy
+                    const uint8_t *src = out - distance;
+                    for (size_t i = 0; i < length; ++i)
+                        out[i] = src[i];
+                    out += length;
+                }
+            }
+        }
+
+        const uint8_t *in;
+        const uint8_t *in_end;
+        size_t overread = 0; // zero bytes shifted in past in_end
+        uint64_t bitbuf = 0;
+        unsigned bitsleft = 0;
+        uint8_t *out_begin;
+        uint8_t *out;
+        uint8_t *out_end;
+        uint32_t litlen_table[LITLEN_TABLE_SIZE];
+        uint32_t dist_table[DIST_TABLE_SIZE];
+    };
+
+    bool inflateGeneric(ByteSpan in, uint8_t *out, size_t outSize) { return Inflater<WordCopy>(in, out, outSize).run(); }
+
+#if defined(IPF_INFLATE_X86)
+    // flatten pulls the whole decoder into each entry point, so it is compiled
+    // for that entry point's instruction set (BMI2 shifts in the bit reader too).
+    __attribute__((target("sse2"), flatten)) bool inflateSse2(ByteSpan in, uint8_t *out, size_t outSize)
+    {
+        return Inflater<Sse2Copy>(in, out, outSize).run();
+    }
+
+    __attribute__((target("avx2,bmi2"), flatten)) bool inflateAvx2(ByteSpan in, uint8_t *out, size_t outSize)
+    {
+        return Inflater<Avx2Copy>(in, out, outSize).run();
+    }
+#endif
+
+#if defined(IPF_INFLATE_NEON)
+    bool inflateNeon(ByteSpan in, uint8_t *out, size_t outSize) { return Inflater<NeonCopy>(in, out, outSize).run(); }
+#endif
+
+    typedef bool (*InflateKernel)(ByteSpan in, uint8_t *out, size_t outSize);
+
+    struct InflateDispatch
+    {
+        InflateKernel kernel = inflateGeneric;
+        const char *name = "generic";
+
+        InflateDispatch()
+        {
+#if defined(IPF_INFLATE_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+            {
+                kernel = inflateAvx2;
+                name = "avx2";
+            }
+            else if (__builtin_cpu_supports("sse2"))
+            {
+                kernel = inflateSse2;
+                name = "sse2";
+            }
+#elif defined(IPF_INFLATE_NEON)
+            kernel = inflateNeon;
+            name = "neon";
+#endif
+        }
+    };
+
+    const InflateDispatch &inflateDispatch()
+    {
+        static const InflateDispatch dispatch;
+        return dispatch;
+    }
+
+    std::atomic<bool> g_fast_inflate_enabled(true);
+}
+
+bool fastInflate(ByteSpan in, uint8_t *out, size_t outSize) { return inflateDispatch().kernel(in, out, outSize); }
+
+const char *getFastInflateImplementation() { return inflateDispatch().name; }
+
+void setFastInflateEnabled(bool enabled) { g_fast_inflate_enabled.store(enabled, std::memory_order_relaxed); }
+
+bool isFastInflateEnabled() { return g_fast_inflate_enabled.load(std::memory_order_relaxed); }
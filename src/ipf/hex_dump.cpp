@@ -0,0 +1,183 @@
+#include "ipf/hex_dump.hpp"
+#include "ipf/entry_stream.hpp"
+#include "ipf/trace.hpp"
+
+#include <cstring>
+
+namespace
+{
+    // Lines gathered before each fwrite
+    const size_t LINES_PER_WRITE = 4096;
+
+    struct HexTables
+    {
+        char pairs[256][2]; // "00".."FF"
+        char ascii[256];    // printable ASCII as is, '.' for the rest
+
+        HexTables()
+        {
+            const char *digits = "0123456789ABCDEF";
+            for (int i = 0; i < 256; ++i)
+            {
+                pairs[i][0] = digits[i >> 4];
+                pairs[i][1] = digits[i & 15];
+                ascii[i] = (i >= 0x20 && i < 0x7F) ? static_cast<char>(i) : '.';
+            }
+        }
+    };
+
+    const HexTables &hexTables()
+    {
+        static const HexTables tables;
+        return tables;
+    }
+}
+
+HexFormatter::HexFormatter(uint64_t totalSize)
+    : offset_bytes(totalSize > 0xFFFFFFFFull ? 8 : 4)
+{
+    // offset, 2 spaces, "XX " per byte, 1 space, ascii column, '\n'
+    line_length = offset_bytes * 2 + 2 + HEX_BYTES_PER_LINE * 3 + 1 + HEX_BYTES_PER_LINE + 1;
+}
+
+size_t HexFormatter::formatLine(uint64_t offset, const uint8_t *bytes, size_t count, char *out) const
+{
+    const HexTables &tables = hexTables();
+    char *p = out;
+    for (unsigned i = offset_bytes; i > 0; --i)
+    {
+        std::memcpy(p, tables.pairs[(offset >> ((i - 1) * 8)) & 0xFF], 2);
+        p += 2;
+    }
+    *p++ = ' ';
+    *p++ = ' ';
+
+    for (size_t j = 0; j < count; ++j)
+    {
+        std::memcpy(p, tables.pairs[bytes[j]], 2);
+        p[2] = ' ';
+        p += 3;
+    }
+    std::memset(p, ' ', (HEX_BYTES_PER_LINE - count) * 3 + 1);
+    p += (HEX_BYTES_PER_LINE - count) * 3 + 1;
+
+    for (size_t j = 0; j < count; ++j)
+        *p++ = tables.ascii[bytes[j]];
+    *p++ = '\n';
+    return static_cast<size_t>(p - out);
+}
+
+void HexFormatter::formatLines(ByteSpan data, uint64_t baseOffset, uint64_t firstLine, size_t lineCount,
+                               std::string &out) const
+{
+    uint64_t totalLines = getLineCount(data.size);
+    if (firstLine >= totalLines)
+        return;
+    if (lineCount > totalLines - firstLine)
+        lineCount = static_cast<size_t>(totalLines - firstLine);
+
+    size_t start = out.size();
+    out.resize(start + lineCount * line_length);
+    char *p = &out[start];
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        size_t pos = static_cast<size_t>((firstLine + i) * HEX_BYTES_PER_LINE);
+        size_t count = data.size - pos < HEX_BYTES_PER_LINE ? data.size - pos : HEX_BYTES_PER_LINE;
+        p += formatLine(baseOffset + pos, data.data + pos, count, p);
+    }
+    out.resize(static_cast<size_t>(p - out.data()));
+}
+
+HexDumpWriter::HexDumpWriter(FILE *out, uint64_t totalSize)
+    : formatter(totalSize), file(out), buffer(formatter.getLineLength() * LINES_PER_WRITE)
+{
+}
+
+bool HexDumpWriter::appendLine(const uint8_t *bytes, size_t count)
+{
+    if (buffer.size() - used < formatter.getLineLength() && !flush())
+        return false;
+    used += formatter.formatLine(offset, bytes, count, buffer.data() + used);
+    offset += count;
+    return true;
+}
+
+bool HexDumpWriter::flush()
+{
+    if (used && !failed)
+    {
+        IPF_TRACE_SCOPE_BYTES(Write, used);
+        failed = std::fwrite(buffer.data(), 1, used, file) != used;
+    }
+    used = 0;
+    return !failed;
+}
+
+bool HexDumpWriter::write(const uint8_t *data, size_t size)
+{
+    if (size == 0)
+        return !failed;
+
+    // Top up a line left over from the previous piece first
+    if (pending_count)
+    {
+        size_t take = HEX_BYTES_PER_LINE - pending_count < size ? HEX_BYTES_PER_LINE - pending_count : size;
+        std::memcpy(pending + pending_count, data, take);
+        pending_count += take;
+        data += take;
+        size -= take;
+        if (pending_count < HEX_BYTES_PER_LINE)
+            return !failed;
+        pending_count = 0;
+        if (!appendLine(pending, HEX_BYTES_PER_LINE))
+            return false;
+    }
+
+    for (; size >= HEX_BYTES_PER_LINE; data += HEX_BYTES_PER_LINE, size -= HEX_BYTES_PER_LINE)
+        if (!appendLine(data, HEX_BYTES_PER_LINE))
+            return false;
+
+    std::memcpy(pending, data, size);
+    pending_count = size;
+    return !failed;
+}
+
+bool HexDumpWriter::finish()
+{
+    if (pending_count && !appendLine(pending, pending_count))
+        return false;
+    pending_count = 0;
+    return flush() && std::fflush(file) == 0;
+}
+
+bool writeHexDump(ByteSpan data, FILE *out)
+{
+    HexDumpWriter writer(out, data.size);
+    return writer.write(data.data, data.size) && writer.finish();
+}
+
+bool writeHexDumpToPath(const IPFEntryView &ent, const std::string &path, std::string &err)
+{
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+    {
+        err = "Failed to create " + path;
+        return false;
+    }
+
+    HexDumpWriter writer(f, ent.getFileSizeUncompressed());
+    bool ok = extractFileStream(ent, [&writer](const uint8_t *data, size_t size)
+                                { return writer.write(data, size); },
+                                err);
+    if (ok && !writer.finish())
+    {
+        err = "Failed to write " + path;
+        ok = false;
+    }
+    if (std::fclose(f) != 0 && ok)
+    {
+        err = "Failed to write " + path;
+        ok = false;
+    }
+    return ok;
+}
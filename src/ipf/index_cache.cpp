@@ -0,0 +1,98 @@
+#include "ipf/index_cache.hpp"
+#include "ipf/crc32.hpp"
+#include "ipf/mapped_file.hpp"
+
+static const size_t INDEX_CACHE_HEADER_SIZE = 20;
+
+bool writeIndexCache(const std::string &path, const IPFIndex &index, const PathIndex &paths,
+                     const std::vector<FileStamp> &stamps, std::string &err)
+{
+    if (stamps.size() != index.containerCount())
+    {
+        err = "Container stamps do not match the index";
+        return false;
+    }
+
+    std::vector<uint8_t> image;
+    image.reserve(INDEX_CACHE_HEADER_SIZE + index.arenaSize() + index.size() * 8 * sizeof(uint32_t));
+    ByteWriter out(image);
+    out.writeLe(INDEX_CACHE_MAGIC);
+    out.writeLe(INDEX_CACHE_VERSION);
+    out.writeLe<uint64_t>(0); // body size, patched below
+    out.writeLe<uint32_t>(0); // body crc32, patched below
+
+    index.serialize(out);
+    for (auto &s : stamps)
+    {
+        out.writeLe(s.size);
+        out.writeLe(s.mtime);
+        out.writeLe(s.mtime_ns);
+        out.writeLe(s.version_to_patch);
+        out.writeLe(s.new_version);
+    }
+    paths.serialize(out);
+
+    uint64_t bodySize = image.size() - INDEX_CACHE_HEADER_SIZE;
+    out.patchLe32(8, static_cast<uint32_t>(bodySize));
+    out.patchLe32(12, static_cast<uint32_t>(bodySize >> 32));
+    out.patchLe32(16, crc32Compute(ByteSpan(image.data() + INDEX_CACHE_HEADER_SIZE, static_cast<size_t>(bodySize))));
+
+    if (!replaceFileBytes(path, image.data(), image.size()))
+    {
+        err = "Failed to write index cache " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readIndexCache(const std::string &path, IPFIndex &index, PathIndex &paths,
+                    std::vector<FileStamp> &stamps, std::string &err)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        err = "No index cache at " + path;
+        return false;
+    }
+
+    ByteCursor in(file.span());
+    uint32_t magic = 0, version = 0, crc = 0;
+    uint64_t bodySize = 0;
+    if (!in.readLe(magic) || !in.readLe(version) || !in.readLe(bodySize) || !in.readLe(crc) ||
+        magic != INDEX_CACHE_MAGIC)
+    {
+        err = "Not an index cache: " + path;
+        return false;
+    }
+    if (version != INDEX_CACHE_VERSION)
+    {
+        err = "Index cache version " + std::to_string(version) + " is outdated";
+        return false;
+    }
+    if (bodySize != in.remaining() ||
+        crc32Compute(ByteSpan(file.data() + INDEX_CACHE_HEADER_SIZE, in.remaining())) != crc)
+    {
+        err = "Index cache is damaged";
+        return false;
+    }
+
+    if (!index.deserialize(in, err))
+        return false;
+    stamps.resize(index.containerCount());
+    for (auto &s : stamps)
+    {
+        if (!in.readLe(s.size) || !in.readLe(s.mtime) || !in.readLe(s.mtime_ns) || !in.readLe(s.version_to_patch) ||
+            !in.readLe(s.new_version))
+        {
+            err = "Truncated container stamps";
+            index.clear();
+            return false;
+        }
+    }
+    if (!paths.deserialize(in, &index, err))
+    {
+        index.clear();
+        return false;
+    }
+    return true;
+}
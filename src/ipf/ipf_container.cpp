@@ -0,0 +1,130 @@
+#include "ipf/ipf_container.hpp"
+#include "ipf/trace.hpp"
+
+#include <cstring>
+
+IPFContainer::IPFContainer(const std::string &path) { open(path); }
+
+bool IPFContainer::open(const std::string &path)
+{
+    IPF_TRACE_SCOPE(Open);
+    file_path = path;
+    is_open = false;
+    file_size = 0;
+
+    if (mapping.open(path))
+    {
+        file_size = mapping.size();
+        is_open = true;
+        return true;
+    }
+
+    // Mapping can fail for empty files, exhausted address space (32-bit builds) or
+    // exotic filesystems; keep the plain stream reader working in those cases.
+    if (!fallback.open(path))
+    {
+        last_error = "Failed to open " + path;
+        return false;
+    }
+    if (!fallback.seek(0, std::ios::end))
+    {
+        last_error = "Failed to query size of " + path;
+        return false;
+    }
+    std::streampos end = fallback.tell();
+    if (end == std::streampos(-1))
+    {
+        last_error = "Failed to query size of " + path;
+        return false;
+    }
+    file_size = static_cast<uint64_t>(end);
+    is_open = true;
+    return true;
+}
+
+void IPFContainer::openDeferred(const std::string &path)
+{
+    file_path = path;
+    is_open = false;
+    file_size = 0;
+    deferred = true;
+}
+
+bool IPFContainer::ensureOpen() const
+{
+    // deferred is only written before the container is shared, so reading it unlocked is fine
+    if (deferred)
+        std::call_once(deferred_once, [this]
+                       { const_cast<IPFContainer *>(this)->open(file_path); });
+    return is_open;
+}
+
+bool IPFContainer::inRange(uint64_t offset, size_t count) const
+{
+    return offset <= file_size && count <= file_size - offset;
+}
+
+bool IPFContainer::getSpan(uint64_t offset, size_t count, ByteSpan &out) const
+{
+    if (!isMapped() || !inRange(offset, count))
+        return false;
+    out = ByteSpan(mapping.data() + offset, count);
+    return true;
+}
+
+int IPFContainer::getFileDescriptor() const
+{
+#if defined(_WIN32)
+    return -1;
+#else
+    return isMapped() ? mapping.getFileDescriptor() : -1;
+#endif
+}
+
+bool IPFContainer::readBytes(uint64_t offset, uint8_t *dst, size_t count, std::string &err) const
+{
+    if (!ensureOpen())
+    {
+        err = "Container not open: " + file_path;
+        return false;
+    }
+    if (!inRange(offset, count))
+    {
+        err = "Read past end of container (" + std::to_string(offset) + " + " + std::to_string(count) + ")";
+        return false;
+    }
+    if (count == 0)
+        return true;
+
+    IPF_TRACE_SCOPE_BYTES(Read, count);
+    if (isMapped())
+    {
+        std::memcpy(dst, mapping.data() + offset, count);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(fallback_mutex);
+    if (!fallback.seek(static_cast<std::streamoff>(offset), std::ios::beg))
+    {
+        err = "Seek to offset " + std::to_string(offset) + " failed";
+        return false;
+    }
+    if (!fallback.readBytes(dst, count))
+    {
+        err = "Failed to read " + std::to_string(count) + " bytes at offset " + std::to_string(offset);
+        return false;
+    }
+    return true;
+}
+
+bool IPFContainer::readBytes(uint64_t offset, size_t count, std::vector<uint8_t> &out, std::string &err) const
+{
+    out.resize(count);
+    return readBytes(offset, out.data(), count, err);
+}
+
+bool IPFContainer::readBytes(uint64_t offset, size_t count, PooledBuffer &out, std::string &err) const
+{
+    out.resizeDiscard(count);
+    return readBytes(offset, out.data(), count, err);
+}
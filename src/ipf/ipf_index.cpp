@@ -0,0 +1,292 @@
+#include "ipf/ipf_index.hpp"
+
+#include <algorithm>
+
+uint32_t IPFIndex::addContainer(const std::string &path, const IPFHeader &header, const std::shared_ptr<IPFContainer> &container)
+{
+    IPFContainerInfo info;
+    info.path = path;
+    info.header = header;
+    info.container = container;
+    containers.push_back(std::move(info));
+    return static_cast<uint32_t>(containers.size() - 1);
+}
+
+uint32_t IPFIndex::addRoot(const std::string &path, const IPFRoot &root)
+{
+    uint32_t id = addContainer(path, root.header, root.container);
+    reserve(size() + root.file_table.size(), 0);
+    for (auto &f : root.file_table)
+    {
+        // directory_name already carries the container stem; keep only the stored name
+        StringRef raw(f.directory_name);
+        raw = raw.substr(raw.size - std::min<size_t>(raw.size, f.directory_name_length));
+        appendEntry(id, f.crc32, f.file_size_compressed, f.file_size_uncompressed, f.file_pointer,
+                    StringRef(f.container_name), raw);
+    }
+    return id;
+}
+
+uint32_t IPFIndex::appendIndex(const IPFIndex &other)
+{
+    uint32_t firstId = static_cast<uint32_t>(containers.size());
+    for (auto &info : other.containers)
+        addContainer(info.path, info.header, info.container);
+
+    reserve(size() + other.size(), arena.size() + other.arena.size());
+    for (uint32_t row = 0; row < other.size(); ++row)
+    {
+        IPFEntryView ent = other.getEntry(row);
+        appendEntry(firstId + ent.getContainerId(), ent.getCrc32(), ent.getFileSizeCompressed(),
+                    ent.getFileSizeUncompressed(), ent.getFilePointer(), ent.getContainerName(), ent.getRawDirectoryName());
+    }
+    return firstId;
+}
+
+uint32_t IPFIndex::internName(StringRef containerName)
+{
+    std::string key = containerName.str();
+    auto it = name_lookup.find(key);
+    if (it != name_lookup.end())
+        return it->second;
+
+    size_t stem = containerName.size;
+    for (size_t i = containerName.size; i > 0; --i)
+        if (containerName[i - 1] == '.')
+        {
+            stem = i - 1;
+            break;
+        }
+
+    uint32_t id = static_cast<uint32_t>(name_offsets.size());
+    name_offsets.push_back(static_cast<uint32_t>(arena.size()));
+    name_lengths.push_back(static_cast<uint16_t>(containerName.size));
+    name_stem_lengths.push_back(static_cast<uint16_t>(stem));
+    arena.append(containerName.data, containerName.size);
+    name_lookup.emplace(std::move(key), id);
+    return id;
+}
+
+uint32_t IPFIndex::appendEntry(uint32_t containerId, uint32_t crc32, uint32_t sizeCompressed, uint32_t sizeUncompressed,
+                               uint32_t filePointer, StringRef containerName, StringRef directoryName)
+{
+    uint32_t nameId = internName(containerName);
+    uint32_t stem = name_stem_lengths[nameId];
+
+    // Logical path "<stem>/<directory name>" is stored once so views and
+    // lookups never have to concatenate.
+    uint32_t offset = static_cast<uint32_t>(arena.size());
+    arena.append(containerName.data, stem);
+    arena.push_back('/');
+    arena.append(directoryName.data, directoryName.size);
+
+    crc_column.push_back(crc32);
+    size_compressed_column.push_back(sizeCompressed);
+    size_uncompressed_column.push_back(sizeUncompressed);
+    file_pointer_column.push_back(filePointer);
+    container_column.push_back(containerId);
+    name_column.push_back(nameId);
+    path_offset_column.push_back(offset);
+    path_length_column.push_back(static_cast<uint32_t>(stem + 1 + directoryName.size));
+    return static_cast<uint32_t>(crc_column.size() - 1);
+}
+
+void IPFIndex::reserve(size_t entries, size_t arenaBytes)
+{
+    crc_column.reserve(entries);
+    size_compressed_column.reserve(entries);
+    size_uncompressed_column.reserve(entries);
+    file_pointer_column.reserve(entries);
+    container_column.reserve(entries);
+    name_column.reserve(entries);
+    path_offset_column.reserve(entries);
+    path_length_column.reserve(entries);
+    if (arenaBytes > arena.capacity())
+        arena.reserve(arenaBytes);
+}
+
+void IPFIndex::clear()
+{
+    crc_column.clear();
+    size_compressed_column.clear();
+    size_uncompressed_column.clear();
+    file_pointer_column.clear();
+    container_column.clear();
+    name_column.clear();
+    path_offset_column.clear();
+    path_length_column.clear();
+    name_offsets.clear();
+    name_lengths.clear();
+    name_stem_lengths.clear();
+    name_lookup.clear();
+    arena.clear();
+    containers.clear();
+}
+
+void IPFIndex::serialize(ByteWriter &out) const
+{
+    out.writeLe<uint32_t>(static_cast<uint32_t>(containers.size()));
+    for (auto &info : containers)
+    {
+        out.writeLe<uint32_t>(static_cast<uint32_t>(info.path.size()));
+        out.writeBytes(info.path.data(), info.path.size());
+        out.writeLe(info.header.file_count);
+        out.writeLe(info.header.file_table_pointer);
+        out.writeLe(info.header.padding);
+        out.writeLe(info.header.header_pointer);
+        out.writeLe(info.header.magic);
+        out.writeLe(info.header.version_to_patch);
+        out.writeLe(info.header.new_version);
+    }
+
+    out.writeColumn(crc_column);
+    out.writeColumn(size_compressed_column);
+    out.writeColumn(size_uncompressed_column);
+    out.writeColumn(file_pointer_column);
+    out.writeColumn(container_column);
+    out.writeColumn(name_column);
+    out.writeColumn(path_offset_column);
+    out.writeColumn(path_length_column);
+
+    out.writeColumn(name_offsets);
+    out.writeColumn(name_lengths);
+    out.writeColumn(name_stem_lengths);
+
+    out.writeLe<uint32_t>(static_cast<uint32_t>(arena.size()));
+    out.writeBytes(arena.data(), arena.size());
+}
+
+bool IPFIndex::deserialize(ByteCursor &in, std::string &err)
+{
+    clear();
+    err = "Truncated index image";
+
+    uint32_t containerCount = 0;
+    if (!in.readLe(containerCount))
+        return false;
+    for (uint32_t i = 0; i < containerCount; ++i)
+    {
+        uint32_t pathLength = 0;
+        IPFContainerInfo info;
+        if (!in.readLe(pathLength) || !in.readString(info.path, pathLength) ||
+            !in.readLe(info.header.file_count) || !in.readLe(info.header.file_table_pointer) ||
+            !in.readLe(info.header.padding) || !in.readLe(info.header.header_pointer) ||
+            !in.readLe(info.header.magic) || !in.readLe(info.header.version_to_patch) ||
+            !in.readLe(info.header.new_version))
+            return false;
+        containers.push_back(std::move(info));
+    }
+
+    uint32_t arenaSize = 0;
+    ByteSpan arenaBytes;
+    if (!in.readColumn(crc_column) || !in.readColumn(size_compressed_column) ||
+        !in.readColumn(size_uncompressed_column) || !in.readColumn(file_pointer_column) ||
+        !in.readColumn(container_column) || !in.readColumn(name_column) ||
+        !in.readColumn(path_offset_column) || !in.readColumn(path_length_column) ||
+        !in.readColumn(name_offsets) || !in.readColumn(name_lengths) || !in.readColumn(name_stem_lengths) ||
+        !in.readLe(arenaSize) || !in.readSpan(arenaBytes, arenaSize))
+    {
+        clear();
+        return false;
+    }
+    arena.assign(reinterpret_cast<const char *>(arenaBytes.data), arenaBytes.size);
+
+    // A stale or damaged image must never turn into out-of-bounds reads later
+    err = "Inconsistent index image";
+    size_t rows = crc_column.size();
+    size_t names = name_offsets.size();
+    if (size_compressed_column.size() != rows || size_uncompressed_column.size() != rows ||
+        file_pointer_column.size() != rows || container_column.size() != rows || name_column.size() != rows ||
+        path_offset_column.size() != rows || path_length_column.size() != rows ||
+        name_lengths.size() != names || name_stem_lengths.size() != names)
+    {
+        clear();
+        return false;
+    }
+    for (size_t i = 0; i < names; ++i)
+    {
+        if (static_cast<uint64_t>(name_offsets[i]) + name_lengths[i] > arena.size() || name_stem_lengths[i] > name_lengths[i])
+        {
+            clear();
+            return false;
+        }
+        name_lookup.emplace(arena.substr(name_offsets[i], name_lengths[i]), static_cast<uint32_t>(i));
+    }
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (container_column[i] >= containers.size() || name_column[i] >= names ||
+            static_cast<uint64_t>(path_offset_column[i]) + path_length_column[i] > arena.size() ||
+            path_length_column[i] < static_cast<uint32_t>(name_stem_lengths[name_column[i]]) + 1)
+        {
+            clear();
+            return false;
+        }
+    }
+    err.clear();
+    return true;
+}
+
+void IPFIndex::setContainer(uint32_t containerId, const std::shared_ptr<IPFContainer> &container)
+{
+    containers[containerId].container = container;
+}
+
+uint32_t IPFEntryView::getContainerId() const { return owner->container_column[row_id]; }
+
+uint16_t IPFEntryView::getDirectoryNameLength() const
+{
+    uint32_t stem = owner->name_stem_lengths[owner->name_column[row_id]];
+    return static_cast<uint16_t>(owner->path_length_column[row_id] - stem - 1);
+}
+
+uint32_t IPFEntryView::getCrc32() const { return owner->crc_column[row_id]; }
+uint32_t IPFEntryView::getFileSizeCompressed() const { return owner->size_compressed_column[row_id]; }
+uint32_t IPFEntryView::getFileSizeUncompressed() const { return owner->size_uncompressed_column[row_id]; }
+uint32_t IPFEntryView::getFilePointer() const { return owner->file_pointer_column[row_id]; }
+uint16_t IPFEntryView::getContainerNameLength() const { return owner->name_lengths[owner->name_column[row_id]]; }
+
+StringRef IPFEntryView::getContainerName() const
+{
+    uint32_t nameId = owner->name_column[row_id];
+    return StringRef(owner->arena.data() + owner->name_offsets[nameId], owner->name_lengths[nameId]);
+}
+
+StringRef IPFEntryView::getDirectoryName() const
+{
+    return StringRef(owner->arena.data() + owner->path_offset_column[row_id], owner->path_length_column[row_id]);
+}
+
+StringRef IPFEntryView::getRawDirectoryName() const
+{
+    uint32_t stem = owner->name_stem_lengths[owner->name_column[row_id]];
+    return getDirectoryName().substr(stem + 1);
+}
+
+const std::string &IPFEntryView::getFilePath() const { return owner->containers[getContainerId()].path; }
+
+const std::shared_ptr<IPFContainer> &IPFEntryView::getContainer() const
+{
+    return owner->containers[getContainerId()].container;
+}
+
+bool IPFEntryView::shouldSkipDecompression() const
+{
+    StringRef name = getDirectoryName();
+    return isStoredFileName(name.data, name.size);
+}
+
+IPFFileTable IPFEntryView::toFileTable() const
+{
+    IPFFileTable f;
+    f.directory_name_length = getDirectoryNameLength();
+    f.crc32 = getCrc32();
+    f.file_size_compressed = getFileSizeCompressed();
+    f.file_size_uncompressed = getFileSizeUncompressed();
+    f.file_pointer = getFilePointer();
+    f.container_name_length = getContainerNameLength();
+    f.container_name = getContainerName().str();
+    f.directory_name = getDirectoryName().str();
+    f.file_path = getFilePath();
+    f.container = getContainer();
+    return f;
+}
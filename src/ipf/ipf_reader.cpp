@@ -1,147 +1,375 @@
 #include "ipf/ipf_reader.hpp"
-#include "ipf/binary_reader.hpp"
+#include "ipf/byte_cursor.hpp"
+#include "ipf/ipf_container.hpp"
 #include "ipf/decrypt.hpp"
 #include "ipf/decompress.hpp"
+#include "ipf/trace.hpp"
 #include "ipf/utils.hpp"
+#include "ipf/verify.hpp"
 
-#include <fstream>
-#include <iostream>
+#include <cstring>
 #include <sstream>
 
-bool readIpfRootFromPath(const std::string &path, IPFRoot &out)
+namespace
 {
-    BinaryReader br(path);
-    if (!br.ok())
+    // One file table record as it appears on disk; names borrow the table buffer.
+    struct RawFileRecord
     {
-        out.warnings.push_back("Failed to open file: " + path);
-        for (auto &e : br.errors())
-            out.warnings.push_back(e.message);
-        return false;
+        uint16_t directory_name_length;
+        uint32_t crc32;
+        uint32_t file_size_compressed;
+        uint32_t file_size_uncompressed;
+        uint32_t file_pointer;
+        uint16_t container_name_length;
+        StringRef container_name;
+        StringRef directory_name;
+    };
+
+    // Container plus header and table bytes, borrowed from the mapping when possible.
+    struct TableRegion
+    {
+        std::shared_ptr<IPFContainer> container;
+        IPFHeader header;
+        ByteSpan table;
+        std::vector<uint8_t> buffer; // backs `table` when the container is not mapped
+    };
+
+    bool parseHeader(ByteSpan bytes, IPFHeader &header, std::vector<std::string> &warnings)
+    {
+        auto fail = [&warnings](const std::string &msg)
+        {
+            warnings.push_back(msg);
+            return false;
+        };
+
+        ByteCursor hc(bytes);
+        if (!hc.readLe<uint16_t>(header.file_count))
+            return fail("Failed to read file_count");
+        if (!hc.readLe<uint32_t>(header.file_table_pointer))
+            return fail("Failed to read file_table_pointer");
+        if (!hc.readLe<uint16_t>(header.padding))
+            return fail("Failed to read padding");
+        if (!hc.readLe<uint32_t>(header.header_pointer))
+            return fail("Failed to read header_pointer");
+        if (!hc.readLe<uint32_t>(header.magic))
+            return fail("Failed to read magic");
+        if (!hc.readLe<uint32_t>(header.version_to_patch))
+            return fail("Failed to read version_to_patch");
+        if (!hc.readLe<uint32_t>(header.new_version))
+            return fail("Failed to read new_version");
+
+        if (header.magic != MAGIC_NUMBER)
+        {
+            std::ostringstream oss;
+            oss << "Header magic mismatch: got 0x" << std::hex << header.magic
+                << " expected 0x" << MAGIC_NUMBER;
+            warnings.push_back(oss.str());
+        }
+        return true;
     }
 
-    auto fail = [&out, &br](const std::string &msg)
+    // Open the container, parse the header and fetch the whole table region
+    // (file_table_pointer up to the header) with a single read or mapping view.
+    bool loadTableRegion(const std::string &path, TableRegion &region, std::vector<std::string> &warnings)
     {
-        out.warnings.push_back(msg);
-        for (auto &e : br.errors())
-            out.warnings.push_back(e.message);
-        return false;
+        auto fail = [&warnings](const std::string &msg)
+        {
+            warnings.push_back(msg);
+            return false;
+        };
+
+        region.container = std::make_shared<IPFContainer>(path);
+        IPFContainer &container = *region.container;
+        if (!container.ok())
+        {
+            warnings.push_back("Failed to open file: " + path);
+            return fail(container.lastError());
+        }
+
+        // Header lives in the last 24 bytes
+        const size_t headerSize = static_cast<size_t>(-HEADER_LOCATION);
+        if (container.size() < headerSize)
+            return fail("Seek to header failed");
+        const uint64_t headerOffset = container.size() - headerSize;
+
+        std::string err;
+        ByteSpan headerBytes;
+        uint8_t headerBuffer[headerSize];
+        if (!container.getSpan(headerOffset, headerSize, headerBytes))
+        {
+            if (!container.readBytes(headerOffset, headerBuffer, headerSize, err))
+            {
+                warnings.push_back("Seek to header failed");
+                return fail(err);
+            }
+            headerBytes = ByteSpan(headerBuffer, headerSize);
+        }
+
+        if (!parseHeader(headerBytes, region.header, warnings))
+            return false;
+
+        const uint32_t tablePointer = region.header.file_table_pointer;
+        if (tablePointer > headerOffset)
+            return fail("Failed to seek to file_table_pointer");
+        const size_t tableSize = static_cast<size_t>(headerOffset - tablePointer);
+
+        if (!container.getSpan(tablePointer, tableSize, region.table))
+        {
+            if (!container.readBytes(tablePointer, tableSize, region.buffer, err))
+            {
+                warnings.push_back("Failed to seek to file_table_pointer");
+                return fail(err);
+            }
+            region.table = ByteSpan(region.buffer.data(), region.buffer.size());
+        }
+        return true;
+    }
+
+    // Walk file_count records of the table region, handing each to visit().
+    template <typename Visitor>
+    bool parseFileTable(const TableRegion &region, std::vector<std::string> &warnings, Visitor &&visit)
+    {
+        auto fail = [&warnings](const std::string &msg)
+        {
+            warnings.push_back(msg);
+            return false;
+        };
+
+        ByteCursor tc(region.table);
+        ByteSpan name;
+
+        for (uint32_t i = 0; i < region.header.file_count; ++i)
+        {
+            RawFileRecord r;
+
+            if (!tc.readLe<uint16_t>(r.directory_name_length))
+                return fail("Failed to read directory_name_length");
+            if (!tc.readLe<uint32_t>(r.crc32))
+                return fail("Failed to read crc32");
+            if (!tc.readLe<uint32_t>(r.file_size_compressed))
+                return fail("Failed to read file_size_compressed");
+            if (!tc.readLe<uint32_t>(r.file_size_uncompressed))
+                return fail("Failed to read file_size_uncompressed");
+            if (!tc.readLe<uint32_t>(r.file_pointer))
+                return fail("Failed to read file_pointer");
+            if (!tc.readLe<uint16_t>(r.container_name_length))
+                return fail("Failed to read container_name_length");
+
+            if (!tc.readSpan(name, r.container_name_length))
+                return fail("Failed to read container_name");
+            r.container_name = StringRef(reinterpret_cast<const char *>(name.data), name.size);
+
+            if (!tc.readSpan(name, r.directory_name_length))
+                return fail("Failed to read directory_name");
+            r.directory_name = StringRef(reinterpret_cast<const char *>(name.data), name.size);
+
+            visit(r);
+        }
+
+        return true;
+    }
+
+    // Where an entry's payload lives and how it is encoded.
+    struct PayloadInfo
+    {
+        uint32_t file_pointer;
+        uint32_t size_compressed;
+        uint32_t size_uncompressed;
+        uint32_t crc32;
+        bool stored;
     };
 
-    // Seek to end-24 to read header
-    if (!br.seek(HEADER_LOCATION, std::ios::end))
-        return fail("Seek to header failed");
-
-    // Read header fields in little-endian
-    if (!br.readLe<uint16_t>(out.header.file_count))
-        return fail("Failed to read file_count");
-    if (!br.readLe<uint32_t>(out.header.file_table_pointer))
-        return fail("Failed to read file_table_pointer");
-    if (!br.readLe<uint16_t>(out.header.padding))
-        return fail("Failed to read padding");
-    if (!br.readLe<uint32_t>(out.header.header_pointer))
-        return fail("Failed to read header_pointer");
-    if (!br.readLe<uint32_t>(out.header.magic))
-        return fail("Failed to read magic");
-    if (!br.readLe<uint32_t>(out.header.version_to_patch))
-        return fail("Failed to read version_to_patch");
-    if (!br.readLe<uint32_t>(out.header.new_version))
-        return fail("Failed to read new_version");
-
-    if (out.header.magic != MAGIC_NUMBER)
-    {
-        std::ostringstream oss;
-        oss << "Header magic mismatch: got 0x" << std::hex << out.header.magic
-            << " expected 0x" << MAGIC_NUMBER;
-        out.warnings.push_back(oss.str());
+    PayloadInfo payloadOf(const IPFFileTable &ent)
+    {
+        return PayloadInfo{ent.file_pointer, ent.file_size_compressed, ent.file_size_uncompressed, ent.crc32,
+                           ent.shouldSkipDecompression()};
     }
 
-    // Seek to file table pointer
-    if (!br.seek(static_cast<std::streamoff>(out.header.file_table_pointer), std::ios::beg))
-        return fail("Failed to seek to file_table_pointer");
+    PayloadInfo payloadOf(const IPFEntryView &ent)
+    {
+        return PayloadInfo{ent.getFilePointer(), ent.getFileSizeCompressed(), ent.getFileSizeUncompressed(),
+                           ent.getCrc32(), ent.shouldSkipDecompression()};
+    }
 
-    out.file_table.clear();
-    out.file_table.reserve(out.header.file_count);
+    // Size a buffer that is about to be overwritten completely
+    void resizeForOverwrite(std::vector<uint8_t> &buffer, size_t size) { buffer.resize(size); }
+    void resizeForOverwrite(PooledBuffer &buffer, size_t size) { buffer.resizeDiscard(size); }
 
-    for (uint32_t i = 0; i < out.header.file_count; ++i)
+    // Compressed bytes go to `scratch`, output is inflated straight into `out` at its
+    // declared size; both buffers keep their capacity for the next call.
+    template <typename Buffer>
+    bool extractPayload(const IPFContainer &container, const PayloadInfo &info, Buffer &out, Buffer &scratch,
+                        std::string &err, bool verifyCrc = false)
     {
-        IPFFileTable f;
+        if (info.stored || info.size_compressed == 0)
+        {
+            if (!container.readBytes(info.file_pointer, info.size_compressed, out, err))
+                return false;
+            return !verifyCrc || verifyStoredBytes(ByteSpan(out.data(), out.size()), info.crc32, err);
+        }
+
+        if (!container.readBytes(info.file_pointer, info.size_compressed, scratch, err))
+            return false;
+        if (verifyCrc && !verifyStoredBytes(ByteSpan(scratch.data(), scratch.size()), info.crc32, err))
+            return false;
+        decryptInplace(MutableByteSpan(scratch.data(), scratch.size()));
+        resizeForOverwrite(out, info.size_uncompressed);
+        return decompressZlibInto(ByteSpan(scratch.data(), scratch.size()), out.data(), out.size(), err);
+    }
+
+    bool extractPayload(const IPFContainer &container, const PayloadInfo &info, std::vector<uint8_t> &out, std::string &err)
+    {
+        std::vector<uint8_t> scratch;
+        return extractPayload(container, info, out, scratch, err);
+    }
+}
 
-        if (!br.readLe<uint16_t>(f.directory_name_length))
-            return fail("Failed to read directory_name_length");
-        if (!br.readLe<uint32_t>(f.crc32))
-            return fail("Failed to read crc32");
-        if (!br.readLe<uint32_t>(f.file_size_compressed))
-            return fail("Failed to read file_size_compressed");
-        if (!br.readLe<uint32_t>(f.file_size_uncompressed))
-            return fail("Failed to read file_size_uncompressed");
-        if (!br.readLe<uint32_t>(f.file_pointer))
-            return fail("Failed to read file_pointer");
-        if (!br.readLe<uint16_t>(f.container_name_length))
-            return fail("Failed to read container_name_length");
-
-        std::vector<uint8_t> tmp;
-
-        if (!br.readBytes(tmp, f.container_name_length))
-            return fail("Failed to read container_name");
-        f.container_name.assign(tmp.begin(), tmp.end());
-
-        if (!br.readBytes(tmp, f.directory_name_length))
-            return fail("Failed to read directory_name");
-        f.directory_name.assign(tmp.begin(), tmp.end());
+bool readIpfRootFromPath(const std::string &path, IPFRoot &out)
+{
+    IPF_TRACE_SCOPE(Parse);
+    TableRegion region;
+    if (!loadTableRegion(path, region, out.warnings))
+        return false;
+
+    out.header = region.header;
+    out.container = region.container;
+    out.file_table.clear();
+    out.file_table.reserve(region.header.file_count);
 
+    return parseFileTable(region, out.warnings, [&](const RawFileRecord &r)
+                          {
+        IPFFileTable f;
+        f.directory_name_length = r.directory_name_length;
+        f.crc32 = r.crc32;
+        f.file_size_compressed = r.file_size_compressed;
+        f.file_size_uncompressed = r.file_size_uncompressed;
+        f.file_pointer = r.file_pointer;
+        f.container_name_length = r.container_name_length;
+        f.container_name = r.container_name.str();
         f.file_path = path;
+        f.container = region.container;
 
-        // Prepend container stem
+        // Prepend container stem, building the final string in one allocation
         auto dotpos = f.container_name.find_last_of('.');
-        std::string stem = (dotpos == std::string::npos) ? f.container_name : f.container_name.substr(0, dotpos);
-        f.directory_name = stem + "/" + f.directory_name;
+        size_t stemLength = (dotpos == std::string::npos) ? f.container_name.size() : dotpos;
+        f.directory_name.reserve(stemLength + 1 + r.directory_name.size);
+        f.directory_name.assign(f.container_name, 0, stemLength);
+        f.directory_name.push_back('/');
+        f.directory_name.append(r.directory_name.data, r.directory_name.size);
 
-        out.file_table.push_back(std::move(f));
-    }
+        out.file_table.push_back(std::move(f)); });
+}
+
+bool readIpfIndexFromPath(const std::string &path, IPFIndex &index, std::vector<std::string> &warnings, uint32_t *containerId)
+{
+    IPF_TRACE_SCOPE(Parse);
+    TableRegion region;
+    if (!loadTableRegion(path, region, warnings))
+        return false;
+
+    uint32_t id = index.addContainer(path, region.header, region.container);
+    if (containerId)
+        *containerId = id;
 
+    // Names plus "<stem>/" rarely exceed the raw table size
+    index.reserve(index.size() + region.header.file_count, index.arenaSize() + region.table.size);
+
+    return parseFileTable(region, warnings, [&](const RawFileRecord &r)
+                          { index.appendEntry(id, r.crc32, r.file_size_compressed, r.file_size_uncompressed,
+                                              r.file_pointer, r.container_name, r.directory_name); });
+}
+
+bool readIpfHeaderFromPath(const std::string &path, IPFHeader &header, std::string &err)
+{
+    // A plain read: mapping the container for 24 bytes would cost more than the read
+    const size_t headerSize = static_cast<size_t>(-HEADER_LOCATION);
+    uint8_t bytes[headerSize];
+    BinaryReader reader;
+    if (!reader.open(path) || !reader.seek(HEADER_LOCATION, std::ios::end) || !reader.readBytes(bytes, headerSize))
+    {
+        err = "Failed to read the header of " + path;
+        return false;
+    }
+    std::vector<std::string> warnings;
+    if (!parseHeader(ByteSpan(bytes, headerSize), header, warnings) || header.magic != MAGIC_NUMBER)
+    {
+        err = path + ": " + (warnings.empty() ? std::string("bad header") : warnings.back());
+        return false;
+    }
     return true;
 }
 
+bool extractFileData(const IPFContainer &container, const IPFFileTable &ent, std::vector<uint8_t> &out, std::string &err)
+{
+    return extractPayload(container, payloadOf(ent), out, err);
+}
+
 bool extractFileData(const IPFFileTable &ent, std::vector<uint8_t> &out, std::string &err)
 {
-    BinaryReader br;
-    if (!br.open(ent.file_path))
+    if (ent.container)
+        return extractFileData(*ent.container, ent, out, err);
+
+    // Entry built by hand without a parsed root: open the container just for this call.
+    IPFContainer container;
+    if (!container.open(ent.file_path))
     {
         err = "Failed to open " + ent.file_path;
         return false;
     }
+    return extractFileData(container, ent, out, err);
+}
 
-    if (!br.seek(static_cast<std::streamoff>(ent.file_pointer), std::ios::beg))
+bool extractFileData(const IPFEntryView &ent, std::vector<uint8_t> &out, std::string &err)
+{
+    const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+    if (!container)
     {
-        err = "Seek to file_pointer failed";
+        err = "Container not open: " + ent.getFilePath();
         return false;
     }
+    return extractPayload(*container, payloadOf(ent), out, err);
+}
 
-    if (ent.file_size_compressed == 0)
+bool extractFileData(const IPFEntryView &ent, std::vector<uint8_t> &out, std::vector<uint8_t> &scratch, std::string &err,
+                     bool verifyCrc)
+{
+    const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+    if (!container)
     {
-        out.clear();
-        return true;
+        err = "Container not open: " + ent.getFilePath();
+        return false;
     }
+    return extractPayload(*container, payloadOf(ent), out, scratch, err, verifyCrc);
+}
 
-    if (!br.readBytes(out, ent.file_size_compressed))
+bool extractFileData(const IPFEntryView &ent, PooledBuffer &out, PooledBuffer &scratch, std::string &err, bool verifyCrc)
+{
+    const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+    if (!container)
     {
-        err = "Failed to read compressed bytes";
+        err = "Container not open: " + ent.getFilePath();
         return false;
     }
+    return extractPayload(*container, payloadOf(ent), out, scratch, err, verifyCrc);
+}
 
-    if (!ent.shouldSkipDecompression())
+bool decodeFileData(const IPFEntryView &ent, MutableByteSpan stored, PooledBuffer &out, std::string &err, bool verifyCrc)
+{
+    if (stored.size != ent.getFileSizeCompressed())
     {
-        // decrypt in-place
-        decryptInplace(out);
-
-        // decompress
-        std::vector<uint8_t> decompressed;
-        if (!decompressZlib(out, decompressed, err))
-        {
-            return false;
-        }
-        out.swap(decompressed);
+        err = "Stored size mismatch: " + ent.getDirectoryName().str();
+        return false;
     }
-
-    return true;
+    if (verifyCrc && !verifyStoredBytes(stored, ent.getCrc32(), err))
+        return false;
+    if (ent.shouldSkipDecompression() || stored.size == 0)
+    {
+        out.resizeDiscard(stored.size);
+        if (stored.size)
+            std::memcpy(out.data(), stored.data, stored.size);
+        return true;
+    }
+    decryptInplace(stored);
+    out.resizeDiscard(ent.getFileSizeUncompressed());
+    return decompressZlibInto(stored, out.data(), out.size(), err);
 }
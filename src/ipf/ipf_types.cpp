@@ -1,7 +1,5 @@
 #include "ipf/ipf_types.hpp"
-#include "ipf/binary_reader.hpp"
-#include "ipf/decompress.hpp"
-#include "ipf/decrypt.hpp"
+#include "ipf/ipf_reader.hpp"
 
 // Helper: case-insensitive strcmp for portability
 int strcasecmp(const char *a, const char *b)
@@ -20,59 +18,31 @@ int strcasecmp(const char *a, const char *b)
     return (unsigned char)*a - (unsigned char)*b;
 }
 
-bool IPFFileTable::shouldSkipDecompression() const
+bool isStoredFileName(const char *name, size_t length)
 {
-    static const std::vector<std::string> ignored = {".fsb", ".jpg", ".mp3"};
-    auto dot = directory_name.find_last_of('.');
-    if (dot == std::string::npos)
+    static const char *const ignored[] = {".fsb", ".jpg", ".mp3"};
+    const char *dot = nullptr;
+    for (size_t i = length; i > 0; --i)
+        if (name[i - 1] == '.')
+        {
+            dot = name + i - 1;
+            break;
+        }
+    if (!dot)
         return false;
-    std::string ext = directory_name.substr(dot);
-    for (auto &e : ignored)
-        if (strcasecmp(e.c_str(), ext.c_str()) == 0)
+    std::string ext(dot, name + length);
+    for (auto e : ignored)
+        if (strcasecmp(e, ext.c_str()) == 0)
             return true;
     return false;
 }
 
-bool IPFFileTable::extractFileData(std::vector<uint8_t> &out, std::string &err)
+bool IPFFileTable::shouldSkipDecompression() const
 {
-    BinaryReader br;
-    if (!br.open(file_path))
-    {
-        err = "Failed to open " + file_path;
-        return false;
-    }
-
-    if (!br.seek(static_cast<std::streamoff>(file_pointer), std::ios::beg))
-    {
-        err = "Seek to file_pointer failed";
-        return false;
-    }
-
-    if (file_size_compressed == 0)
-    {
-        out.clear();
-        return true;
-    }
-
-    if (!br.readBytes(out, file_size_compressed))
-    {
-        err = "Failed to read compressed bytes";
-        return false;
-    }
-
-    if (!shouldSkipDecompression())
-    {
-        // decrypt in-place
-        decryptInplace(out);
-
-        // decompress
-        std::vector<uint8_t> decompressed;
-        if (!decompressZlib(out, decompressed, err))
-        {
-            return false;
-        }
-        out.swap(decompressed);
-    }
+    return isStoredFileName(directory_name.data(), directory_name.size());
+}
 
-    return true;
+bool IPFFileTable::extractFileData(std::vector<uint8_t> &out, std::string &err)
+{
+    return ::extractFileData(*this, out, err);
 }
@@ -0,0 +1,305 @@
+#include "ipf/ipf_vfs.hpp"
+#include "ipf/index_cache.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/ipf_reader.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+namespace
+{
+    void setVersions(FileStamp &stamp, const IPFHeader &header)
+    {
+        stamp.version_to_patch = header.version_to_patch;
+        stamp.new_version = header.new_version;
+    }
+}
+
+bool isAppliedBefore(const IPFContainerInfo &a, const IPFContainerInfo &b)
+{
+    if (a.header.new_version != b.header.new_version)
+        return a.header.new_version < b.header.new_version;
+    if (a.header.version_to_patch != b.header.version_to_patch)
+        return a.header.version_to_patch < b.header.version_to_patch;
+    return a.path < b.path;
+}
+
+bool IPFFileSystem::mount(const std::string &dataDir, std::vector<std::string> &warnings, size_t threadCount)
+{
+    std::vector<std::string> paths;
+    if (!listFilesRecursive(dataDir, ".ipf", paths))
+    {
+        warnings.push_back("Failed to scan data directory: " + dataDir);
+        return false;
+    }
+    return mountFiles(paths, warnings, threadCount);
+}
+
+void IPFFileSystem::parseContainers(const std::vector<std::string> &paths, std::vector<IPFIndex> &parsed,
+                                    std::vector<char> &ok, std::vector<std::string> &warnings, size_t threadCount)
+{
+    parsed.resize(paths.size());
+    ok.assign(paths.size(), 0);
+    std::vector<std::vector<std::string>> parseWarnings(paths.size());
+
+    size_t threads = threadCount ? threadCount : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min<size_t>(threads, std::max<size_t>(paths.size(), 1)));
+    {
+        ThreadPool pool(threads, SchedulingMode::WorkStealing);
+        pool.parallelFor(0, paths.size(), 1, [&](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+                ok[i] = readIpfIndexFromPath(paths[i], parsed[i], parseWarnings[i]) ? 1 : 0; });
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        for (auto &w : parseWarnings[i])
+            warnings.push_back(paths[i] + ": " + w);
+        if (!ok[i])
+            warnings.push_back("Skipping unreadable container: " + paths[i]);
+    }
+}
+
+void IPFFileSystem::applyInPatchOrder(std::vector<IPFIndex> &parts, const std::vector<FileStamp> &stamps)
+{
+    std::vector<size_t> order(parts.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&parts](size_t a, size_t b)
+              { return isAppliedBefore(parts[a].getContainerInfo(0), parts[b].getContainerInfo(0)); });
+
+    size_t totalRows = index.size(), totalArena = index.arenaSize();
+    for (size_t i : order)
+    {
+        totalRows += parts[i].size();
+        totalArena += parts[i].arenaSize();
+    }
+    index.reserve(totalRows, totalArena);
+
+    for (size_t i : order)
+    {
+        container_order.push_back(index.appendIndex(parts[i]));
+        container_stamps.push_back(stamps[i]);
+        parts[i] = IPFIndex(); // drop the per-container copy early
+    }
+
+    rebuildLookup();
+}
+
+bool IPFFileSystem::mountFiles(const std::vector<std::string> &paths, std::vector<std::string> &warnings, size_t threadCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Parse every container on its own index in parallel, then merge in patch order
+    std::vector<IPFIndex> parsed;
+    std::vector<char> parsedOk;
+    parseContainers(paths, parsed, parsedOk, warnings, threadCount);
+
+    std::vector<IPFIndex> parts;
+    std::vector<FileStamp> stamps;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!parsedOk[i])
+            continue;
+        FileStamp stamp;
+        getFileStamp(paths[i], stamp);
+        setVersions(stamp, parsed[i].getContainerInfo(0).header);
+        parts.push_back(std::move(parsed[i]));
+        stamps.push_back(stamp);
+    }
+    applyInPatchOrder(parts, stamps);
+
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "Mounted %zu containers, %zu entries, %zu unique paths in %.2fs",
+                  parts.size(), index.size(), path_index.size(),
+                  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    logInfo(buf);
+    return !parts.empty() || paths.empty();
+}
+
+bool IPFFileSystem::mountCached(const std::string &dataDir, const std::string &cachePath,
+                                std::vector<std::string> &warnings, size_t threadCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> paths;
+    if (!listFilesRecursive(dataDir, ".ipf", paths))
+    {
+        warnings.push_back("Failed to scan data directory: " + dataDir);
+        return false;
+    }
+    std::unordered_map<std::string, FileStamp> current;
+    for (auto &p : paths)
+    {
+        FileStamp stamp;
+        if (getFileStamp(p, stamp))
+            current.emplace(p, stamp);
+    }
+
+    // Load straight into the members so the path table is bound to the right index
+    clear();
+    std::string err;
+    if (!readIndexCache(cachePath, index, path_index, container_stamps, err))
+    {
+        logInfo(err + ", building a new one");
+        clear();
+    }
+
+    std::vector<char> reuse(index.containerCount(), 0);
+    size_t reused = 0;
+    for (uint32_t c = 0; c < index.containerCount(); ++c)
+    {
+        const std::string &path = index.getContainerInfo(c).path;
+        auto it = current.find(path);
+        if (it == current.end() || it->second.size != container_stamps[c].size ||
+            it->second.mtime != container_stamps[c].mtime || it->second.mtime_ns != container_stamps[c].mtime_ns)
+            continue;
+
+        // The file looks untouched; its header still has to name the same versions
+        IPFHeader header;
+        if (!readIpfHeaderFromPath(path, header, err))
+            continue;
+        setVersions(it->second, header);
+        if (it->second == container_stamps[c])
+        {
+            reuse[c] = 1;
+            ++reused;
+        }
+    }
+
+    // Nothing added, removed or touched: the cached image is the mount
+    if (reused == index.containerCount() && reused == current.size() && reused > 0)
+    {
+        for (uint32_t c = 0; c < index.containerCount(); ++c)
+        {
+            auto container = std::make_shared<IPFContainer>();
+            container->openDeferred(index.getContainerInfo(c).path);
+            index.setContainer(c, container);
+            container_order.push_back(c);
+        }
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "Mounted %zu containers, %zu entries, %zu unique paths from cache in %.2fs",
+                      index.containerCount(), index.size(), path_index.size(),
+                      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        logInfo(buf);
+        return true;
+    }
+
+    // Split the still-valid part of the cache back into single-container indexes
+    IPFIndex cached = std::move(index);
+    std::vector<FileStamp> cachedStamps = std::move(container_stamps);
+    clear();
+
+    std::vector<IPFIndex> parts;
+    std::vector<FileStamp> stamps;
+    std::vector<uint32_t> partOf(cached.containerCount(), 0);
+    for (uint32_t c = 0; c < cached.containerCount(); ++c)
+    {
+        if (!reuse[c])
+            continue;
+        const IPFContainerInfo &info = cached.getContainerInfo(c);
+        auto container = std::make_shared<IPFContainer>();
+        container->openDeferred(info.path);
+        partOf[c] = static_cast<uint32_t>(parts.size());
+        parts.emplace_back();
+        parts.back().addContainer(info.path, info.header, container);
+        stamps.push_back(cachedStamps[c]);
+        current.erase(info.path);
+    }
+    for (uint32_t row = 0; row < cached.size(); ++row)
+    {
+        IPFEntryView ent = cached.getEntry(row);
+        if (!reuse[ent.getContainerId()])
+            continue;
+        parts[partOf[ent.getContainerId()]].appendEntry(0, ent.getCrc32(), ent.getFileSizeCompressed(),
+                                                        ent.getFileSizeUncompressed(), ent.getFilePointer(),
+                                                        ent.getContainerName(), ent.getRawDirectoryName());
+    }
+    cached.clear();
+
+    // Whatever is left in current is new or changed
+    std::vector<std::string> stale;
+    for (auto &p : paths)
+        if (current.count(p))
+            stale.push_back(p);
+    std::vector<IPFIndex> parsed;
+    std::vector<char> parsedOk;
+    parseContainers(stale, parsed, parsedOk, warnings, threadCount);
+    size_t parsedCount = 0;
+    for (size_t i = 0; i < stale.size(); ++i)
+    {
+        if (!parsedOk[i])
+            continue;
+        FileStamp stamp = current[stale[i]];
+        setVersions(stamp, parsed[i].getContainerInfo(0).header);
+        parts.push_back(std::move(parsed[i]));
+        stamps.push_back(stamp);
+        ++parsedCount;
+    }
+    applyInPatchOrder(parts, stamps);
+
+    if (!saveCache(cachePath, err))
+        warnings.push_back(err);
+
+    char buf[192];
+    std::snprintf(buf, sizeof(buf),
+                  "Mounted %zu containers (%zu cached, %zu parsed), %zu entries, %zu unique paths in %.2fs",
+                  parts.size(), reused, parsedCount, index.size(), path_index.size(),
+                  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    logInfo(buf);
+    return !parts.empty() || paths.empty();
+}
+
+bool IPFFileSystem::saveCache(const std::string &cachePath, std::string &err) const
+{
+    return writeIndexCache(cachePath, index, path_index, container_stamps, err);
+}
+
+void IPFFileSystem::rebuildLookup()
+{
+    // Rows are appended container by container in patch order, so inserting
+    // them in row order lets the latest container win.
+    path_index.reset(&index, index.size());
+    for (uint32_t row = 0; row < index.size(); ++row)
+        path_index.insertOrReplace(row);
+    path_index.finalize();
+}
+
+void IPFFileSystem::clear()
+{
+    index.clear();
+    path_index.reset(&index, 0);
+    container_order.clear();
+    container_stamps.clear();
+}
+
+bool IPFFileSystem::find(StringRef path, IPFEntryView &out) const
+{
+    uint32_t row = path_index.find(path);
+    if (row == PathHashTable::NO_ROW)
+        return false;
+    out = index.getEntry(row);
+    return true;
+}
+
+uint32_t IPFFileSystem::getVersion() const
+{
+    uint32_t version = 0;
+    for (size_t c = 0; c < index.containerCount(); ++c)
+        version = std::max(version, index.getContainerInfo(static_cast<uint32_t>(c)).header.new_version);
+    return version;
+}
+
+std::vector<uint32_t> IPFFileSystem::getVisibleRows() const
+{
+    std::vector<uint32_t> rows;
+    rows.reserve(path_index.size());
+    path_index.getTable().forEachRow([&rows](uint32_t r)
+                      { rows.push_back(r); });
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
@@ -0,0 +1,397 @@
+#include "ipf/ipf_writer.hpp"
+#include "ipf/byte_cursor.hpp"
+#include "ipf/crc32.hpp"
+#include "ipf/decompress.hpp"
+#include "ipf/decrypt.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/ipf_reader.hpp"
+#include "ipf/path_table.hpp"
+#include "ipf/utils.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+    // Payload ready to be appended, as produced by a worker.
+    struct EncodedEntry
+    {
+        std::vector<uint8_t> bytes;
+        uint32_t crc32 = 0;
+        uint32_t size_uncompressed = 0;
+        std::string error;
+    };
+
+    struct TableRecord
+    {
+        std::string name;
+        std::string container_name;
+        uint32_t crc32;
+        uint32_t size_compressed;
+        uint32_t size_uncompressed;
+        uint32_t file_pointer;
+    };
+
+    bool readWholeFile(const std::string &path, std::vector<uint8_t> &out)
+    {
+        std::ifstream f(path, std::ios::binary);
+        if (!f)
+            return false;
+        f.seekg(0, std::ios::end);
+        std::streamoff size = f.tellg();
+        if (size < 0)
+            return false;
+        f.seekg(0, std::ios::beg);
+        out.resize(static_cast<size_t>(size));
+        return size == 0 || static_cast<bool>(f.read(reinterpret_cast<char *>(out.data()), size));
+    }
+
+    // Runs on a worker: deflate + encrypt, or pass stored types through.
+    void encodeEntry(const std::string &name, std::vector<uint8_t> &plain, const std::string &sourcePath,
+                     int level, EncodedEntry &out)
+    {
+        if (!sourcePath.empty() && !readWholeFile(sourcePath, plain))
+        {
+            out.error = "Failed to read " + sourcePath;
+            return;
+        }
+        if (plain.size() > UINT32_MAX)
+        {
+            out.error = name + ": larger than 4 GB";
+            return;
+        }
+        out.size_uncompressed = static_cast<uint32_t>(plain.size());
+
+        if (isStoredFileName(name.data(), name.size()))
+            out.bytes.swap(plain);
+        else
+        {
+            if (!compressDeflate(ByteSpan(plain.data(), plain.size()), out.bytes, level, out.error))
+            {
+                out.error = name + ": " + out.error;
+                return;
+            }
+            encryptInplace(MutableByteSpan(out.bytes.data(), out.bytes.size()));
+        }
+        // The table CRC covers the bytes exactly as stored
+        out.crc32 = crc32Compute(ByteSpan(out.bytes.data(), out.bytes.size()));
+        std::vector<uint8_t>().swap(plain);
+    }
+
+    std::string fileNameOf(const std::string &path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    std::string foldedKey(const std::string &name)
+    {
+        std::string key(name);
+        for (auto &c : key)
+            c = foldPathChar(c);
+        return key;
+    }
+}
+
+std::string IPFWriteStats::toString() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%llu entries (%llu encoded, %llu copied), %.1f MB -> %.1f MB in %.2fs",
+                  static_cast<unsigned long long>(entries), static_cast<unsigned long long>(encoded),
+                  static_cast<unsigned long long>(copied), bytes_in / (1024.0 * 1024.0),
+                  bytes_out / (1024.0 * 1024.0), seconds);
+    return buf;
+}
+
+void IPFWriter::addFile(const std::string &name, std::vector<uint8_t> &&data)
+{
+    PendingEntry e;
+    e.name = name;
+    e.data = std::move(data);
+    entries.push_back(std::move(e));
+}
+
+void IPFWriter::addFileFromPath(const std::string &name, const std::string &sourcePath)
+{
+    PendingEntry e;
+    e.name = name;
+    e.source_path = sourcePath;
+    entries.push_back(std::move(e));
+}
+
+void IPFWriter::addCopy(const IPFEntryView &source)
+{
+    addCopy(source, source.getRawDirectoryName().str());
+}
+
+void IPFWriter::addCopy(const IPFEntryView &source, const std::string &name)
+{
+    PendingEntry e;
+    e.name = name;
+    e.container_name = source.getContainerName().str();
+    e.source = source;
+    entries.push_back(std::move(e));
+}
+
+bool IPFWriter::write(const std::string &outPath, IPFWriteStats &stats, std::string &err)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (entries.size() > UINT16_MAX)
+    {
+        err = "IPF containers hold at most 65535 entries, got " + std::to_string(entries.size());
+        return false;
+    }
+    std::string containerName = options.container_name.empty() ? fileNameOf(outPath) : options.container_name;
+    if (containerName.size() > UINT16_MAX)
+    {
+        err = "Container name too long";
+        return false;
+    }
+    for (auto &e : entries)
+    {
+        if (e.name.size() > UINT16_MAX || e.container_name.size() > UINT16_MAX)
+        {
+            err = "Entry name too long: " + e.name.substr(0, 64);
+            return false;
+        }
+        // A copied payload is only readable under a name of the same kind
+        if (e.source.isValid() &&
+            isStoredFileName(e.name.data(), e.name.size()) != e.source.shouldSkipDecompression())
+        {
+            err = "Cannot copy " + e.source.getDirectoryName().str() + " as " + e.name +
+                  ": stored and compressed types differ";
+            return false;
+        }
+    }
+
+    std::string tempPath = outPath + ".tmp";
+    FILE *f = std::fopen(tempPath.c_str(), "wb");
+    if (!f)
+    {
+        err = "Failed to create " + tempPath;
+        return false;
+    }
+    std::vector<char> fileBuffer(1 << 20);
+    std::setvbuf(f, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+    uint64_t offset = 0;
+    bool ok = true;
+    auto append = [&](const uint8_t *data, size_t size)
+    {
+        if (ok && size && std::fwrite(data, 1, size, f) != size)
+        {
+            err = "Failed to write " + tempPath;
+            ok = false;
+        }
+        offset += size;
+    };
+
+    size_t threads = options.thread_count ? options.thread_count : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, threads);
+    size_t window = options.max_in_flight ? options.max_in_flight : threads * 4;
+
+    std::vector<TableRecord> table;
+    table.reserve(entries.size());
+    std::vector<uint8_t> copyBuffer;
+    {
+        ThreadPool pool(threads);
+        std::deque<std::future<void>> inFlight;
+        std::deque<EncodedEntry> results;
+        size_t submitted = 0;
+
+        // Keep up to `window` entries encoding ahead of the one being written
+        auto submitUpTo = [&](size_t limit)
+        {
+            for (; submitted < entries.size() && submitted < limit; ++submitted)
+            {
+                PendingEntry &e = entries[submitted];
+                results.emplace_back();
+                if (e.source.isValid())
+                {
+                    inFlight.emplace_back();
+                    continue;
+                }
+                EncodedEntry *slot = &results.back();
+                int level = options.compression_level;
+                inFlight.push_back(pool.enqueue([&e, slot, level]
+                                                { encodeEntry(e.name, e.data, e.source_path, level, *slot); }));
+            }
+        };
+
+        for (size_t i = 0; i < entries.size() && ok; ++i)
+        {
+            submitUpTo(i + window);
+            if (inFlight.front().valid())
+                inFlight.front().get();
+            EncodedEntry &encoded = results.front();
+            PendingEntry &e = entries[i];
+
+            if (offset > UINT32_MAX)
+            {
+                err = "Container larger than 4 GB";
+                ok = false;
+                break;
+            }
+            TableRecord rec;
+            rec.name = e.name;
+            rec.container_name = e.container_name.empty() ? containerName : e.container_name;
+            rec.file_pointer = static_cast<uint32_t>(offset);
+
+            if (e.source.isValid())
+            {
+                const std::shared_ptr<IPFContainer> &source = e.source.getContainer();
+                ByteSpan bytes;
+                if (!source || !source->getSpan(e.source.getFilePointer(), e.source.getFileSizeCompressed(), bytes))
+                {
+                    if (!source || !source->readBytes(e.source.getFilePointer(), e.source.getFileSizeCompressed(),
+                                                      copyBuffer, err))
+                    {
+                        err = "Failed to copy " + e.source.getDirectoryName().str() + (source ? ": " + err : "");
+                        ok = false;
+                        break;
+                    }
+                    bytes = ByteSpan(copyBuffer.data(), copyBuffer.size());
+                }
+                rec.crc32 = e.source.getCrc32();
+                rec.size_compressed = e.source.getFileSizeCompressed();
+                rec.size_uncompressed = e.source.getFileSizeUncompressed();
+                append(bytes.data, bytes.size);
+                ++stats.copied;
+            }
+            else
+            {
+                if (!encoded.error.empty())
+                {
+                    err = encoded.error;
+                    ok = false;
+                    break;
+                }
+                rec.crc32 = encoded.crc32;
+                rec.size_compressed = static_cast<uint32_t>(encoded.bytes.size());
+                rec.size_uncompressed = encoded.size_uncompressed;
+                append(encoded.bytes.data(), encoded.bytes.size());
+                ++stats.encoded;
+            }
+            stats.bytes_in += rec.size_uncompressed;
+            table.push_back(std::move(rec));
+
+            inFlight.pop_front();
+            results.pop_front();
+        }
+
+        // On failure, let queued encodes finish before their inputs go away
+        for (auto &fut : inFlight)
+            if (fut.valid())
+                fut.wait();
+    }
+
+    // File table, then the 24-byte header trailer
+    std::vector<uint8_t> tail;
+    ByteWriter out(tail);
+    uint64_t tablePointer = offset;
+    for (auto &rec : table)
+    {
+        out.writeLe<uint16_t>(static_cast<uint16_t>(rec.name.size()));
+        out.writeLe(rec.crc32);
+        out.writeLe(rec.size_compressed);
+        out.writeLe(rec.size_uncompressed);
+        out.writeLe(rec.file_pointer);
+        out.writeLe<uint16_t>(static_cast<uint16_t>(rec.container_name.size()));
+        out.writeBytes(rec.container_name.data(), rec.container_name.size());
+        out.writeBytes(rec.name.data(), rec.name.size());
+    }
+    uint64_t headerPointer = tablePointer + tail.size();
+    if (ok && headerPointer > UINT32_MAX)
+    {
+        err = "Container larger than 4 GB";
+        ok = false;
+    }
+    out.writeLe<uint16_t>(static_cast<uint16_t>(table.size()));
+    out.writeLe<uint32_t>(static_cast<uint32_t>(tablePointer));
+    out.writeLe<uint16_t>(0);
+    out.writeLe<uint32_t>(static_cast<uint32_t>(headerPointer));
+    out.writeLe(MAGIC_NUMBER);
+    out.writeLe(options.version_to_patch);
+    out.writeLe(options.new_version);
+    append(tail.data(), tail.size());
+
+    if (std::fclose(f) != 0 && ok)
+    {
+        err = "Failed to write " + tempPath;
+        ok = false;
+    }
+    if (ok && !replaceFile(tempPath, outPath))
+    {
+        err = "Failed to replace " + outPath;
+        ok = false;
+    }
+    if (!ok)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    stats.entries += table.size();
+    stats.bytes_out += offset;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool repackContainer(const std::string &inPath, const std::string &outPath,
+                     std::map<std::string, std::vector<uint8_t>> &&changes, const std::vector<std::string> &removed,
+                     IPFWriterOptions options, IPFWriteStats &stats, std::string &err)
+{
+    IPFIndex source;
+    std::vector<std::string> warnings;
+    if (!readIpfIndexFromPath(inPath, source, warnings))
+    {
+        err = "Failed to read " + inPath + (warnings.empty() ? "" : ": " + warnings.back());
+        return false;
+    }
+
+    const IPFContainerInfo &info = source.getContainerInfo(0);
+    if (options.version_to_patch == 0 && options.new_version == 0)
+    {
+        options.version_to_patch = info.header.version_to_patch;
+        options.new_version = info.header.new_version;
+    }
+    if (options.container_name.empty() && !source.empty())
+        options.container_name = source.getEntry(0).getContainerName().str();
+
+    // Names are matched the way the game does, ignoring case
+    std::unordered_map<std::string, std::map<std::string, std::vector<uint8_t>>::iterator> changed;
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+        changed.emplace(foldedKey(it->first), it);
+    std::unordered_map<std::string, bool> dropped;
+    for (auto &name : removed)
+        dropped.emplace(foldedKey(name), true);
+
+    IPFWriter writer(options);
+    for (uint32_t row = 0; row < source.size(); ++row)
+    {
+        IPFEntryView ent = source.getEntry(row);
+        std::string key = foldedKey(ent.getRawDirectoryName().str());
+        if (dropped.count(key))
+            continue;
+        auto it = changed.find(key);
+        if (it == changed.end())
+        {
+            writer.addCopy(ent);
+            continue;
+        }
+        writer.addFile(ent.getRawDirectoryName().str(), std::move(it->second->second));
+        changed.erase(it);
+    }
+    // Whatever did not replace an existing entry is new; keep the caller's order
+    for (auto it = changes.begin(); it != changes.end(); ++it)
+        if (changed.count(foldedKey(it->first)))
+            writer.addFile(it->first, std::move(it->second));
+
+    return writer.write(outPath, stats, err);
+}
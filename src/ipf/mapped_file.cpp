@@ -0,0 +1,136 @@
+#include "ipf/mapped_file.hpp"
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path) { open(path); }
+
+MappedFile::~MappedFile() { close(); }
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        last_error = "CreateFile failed: " + path;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0 ||
+        static_cast<uint64_t>(fileSize.QuadPart) > static_cast<uint64_t>(SIZE_MAX))
+    {
+        // Empty (or unaddressable) files cannot be mapped; callers fall back to stream reads.
+        last_error = "Cannot map file of this size: " + path;
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        last_error = "CreateFileMapping failed: " + path;
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        last_error = "MapViewOfFile failed: " + path;
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    map_data = static_cast<const uint8_t *>(view);
+    map_size = static_cast<uint64_t>(fileSize.QuadPart);
+    is_open = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (map_data)
+        UnmapViewOfFile(map_data);
+    if (mapping_handle)
+        CloseHandle(static_cast<HANDLE>(mapping_handle));
+    if (file_handle)
+        CloseHandle(static_cast<HANDLE>(file_handle));
+    map_data = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    map_size = 0;
+    is_open = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        last_error = "open failed: " + path;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+        static_cast<uint64_t>(st.st_size) > static_cast<uint64_t>(SIZE_MAX))
+    {
+        // Empty (or unaddressable) files cannot be mapped; callers fall back to stream reads.
+        last_error = "Cannot map file of this size: " + path;
+        ::close(fd);
+        return false;
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        last_error = "mmap failed: " + path;
+        ::close(fd);
+        return false;
+    }
+
+    file_descriptor = fd;
+    map_data = static_cast<const uint8_t *>(view);
+    map_size = static_cast<uint64_t>(st.st_size);
+    is_open = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (map_data)
+        munmap(const_cast<uint8_t *>(map_data), static_cast<size_t>(map_size));
+    if (file_descriptor >= 0)
+        ::close(file_descriptor);
+    map_data = nullptr;
+    file_descriptor = -1;
+    map_size = 0;
+    is_open = false;
+}
+
+#endif
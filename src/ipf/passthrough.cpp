@@ -0,0 +1,146 @@
+#include "ipf/passthrough.hpp"
+#include "ipf/entry_stream.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/trace.hpp"
+#include "ipf/utils.hpp"
+#include "ipf/verify.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace
+{
+    bool checkStored(const IPFEntryView &ent, std::string &err)
+    {
+        if (!ent.shouldSkipDecompression())
+        {
+            err = "Entry is not stored raw: " + ent.getDirectoryName().str();
+            return false;
+        }
+        if (!ent.getContainer())
+        {
+            err = "Container not open: " + ent.getFilePath();
+            return false;
+        }
+        return true;
+    }
+
+#if !defined(_WIN32)
+    bool writeAll(int fd, const uint8_t *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Kernel-side copy of [offset, offset + count) from inFd to outFd's current
+    // position. Returns how many bytes made it; the caller finishes the rest.
+    size_t kernelCopy(int inFd, uint64_t offset, int outFd, size_t count)
+    {
+        size_t copied = 0;
+#if defined(__linux__)
+#if defined(SYS_copy_file_range)
+        // Fails with EXDEV/ENOSYS/EINVAL on older kernels and some filesystem pairs
+        loff_t in = static_cast<loff_t>(offset);
+        while (copied < count)
+        {
+            ssize_t n = syscall(SYS_copy_file_range, inFd, &in, outFd, nullptr, count - copied, 0u);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            copied += static_cast<size_t>(n);
+        }
+#endif
+        off_t pos = static_cast<off_t>(offset + copied);
+        while (copied < count)
+        {
+            ssize_t n = sendfile(outFd, inFd, &pos, count - copied);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            copied += static_cast<size_t>(n);
+        }
+#else
+        (void)inFd;
+        (void)offset;
+        (void)outFd;
+        (void)count;
+#endif
+        return copied;
+    }
+#endif
+}
+
+bool getStoredSpan(const IPFEntryView &ent, ByteSpan &out, std::string &err)
+{
+    if (!checkStored(ent, err))
+        return false;
+    if (!ent.getContainer()->getSpan(ent.getFilePointer(), ent.getFileSizeCompressed(), out))
+    {
+        err = "Container is not mapped: " + ent.getFilePath();
+        return false;
+    }
+    return true;
+}
+
+bool copyStoredEntryToPath(const IPFEntryView &ent, const std::string &outPath, std::string &err, bool verifyCrc)
+{
+    if (!checkStored(ent, err))
+        return false;
+
+    const IPFContainer &container = *ent.getContainer();
+    ByteSpan mapped;
+    bool isMapped = container.getSpan(ent.getFilePointer(), ent.getFileSizeCompressed(), mapped);
+    if (!isMapped)
+    {
+        // No mapping to copy from; the chunked stream handles reads and the CRC
+        return extractFileToPath(ent, outPath, err, DEFAULT_STREAM_CHUNK_SIZE, verifyCrc);
+    }
+    if (verifyCrc && !verifyStoredBytes(mapped, ent.getCrc32(), err))
+        return false;
+
+#if defined(_WIN32)
+    if (!writeFileBytes(outPath, mapped.data, mapped.size))
+    {
+        err = "Failed to write " + outPath;
+        return false;
+    }
+    return true;
+#else
+    IPF_TRACE_SCOPE_BYTES(Write, mapped.size);
+    int out = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+    {
+        err = "Failed to create " + outPath;
+        return false;
+    }
+
+    size_t done = kernelCopy(container.getFileDescriptor(), ent.getFilePointer(), out, mapped.size);
+    bool ok = writeAll(out, mapped.data + done, mapped.size - done);
+    ok = (::close(out) == 0) && ok;
+    if (!ok)
+        err = "Failed to write " + outPath;
+    return ok;
+#endif
+}
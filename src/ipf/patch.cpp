@@ -0,0 +1,166 @@
+#include "ipf/patch.hpp"
+#include "ipf/ipf_reader.hpp"
+#include "ipf/path_table.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_set>
+
+namespace
+{
+    // Largest single patch container; keeps every file_pointer well inside 32 bits.
+    const uint64_t MAX_PATCH_BYTES = 2ull * 1024 * 1024 * 1024;
+    const size_t MAX_PATCH_ENTRIES = 65535;
+
+    bool sameRecord(const IPFEntryView &a, const IPFEntryView &b)
+    {
+        return a.getCrc32() == b.getCrc32() && a.getFileSizeCompressed() == b.getFileSizeCompressed() &&
+               a.getFileSizeUncompressed() == b.getFileSizeUncompressed();
+    }
+
+    std::string partPath(const std::string &outPath, size_t part)
+    {
+        if (part == 0)
+            return outPath;
+        size_t dot = outPath.find_last_of('.');
+        size_t slash = outPath.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return outPath + "_" + std::to_string(part);
+        return outPath.substr(0, dot) + "_" + std::to_string(part) + outPath.substr(dot);
+    }
+
+    std::string foldedName(StringRef name)
+    {
+        std::string key = name.str();
+        for (auto &c : key)
+            c = foldPathChar(c);
+        return key;
+    }
+}
+
+std::string IPFDiff::toString() const
+{
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "%zu added, %zu changed, %zu removed, %llu unchanged", added.size(),
+                  changed.size(), removed.size(), static_cast<unsigned long long>(unchanged));
+    return buf;
+}
+
+void diffFileSystems(const IPFFileSystem &from, const IPFFileSystem &to, IPFDiff &diff)
+{
+    const PathIndex &oldPaths = from.getPaths();
+    const PathIndex &newPaths = to.getPaths();
+
+    // Walk both sides in path order so the patch is laid out like the tree
+    for (uint32_t row : newPaths.getSorted())
+    {
+        IPFEntryView ent = to.getIndex().getEntry(row);
+        uint32_t old = oldPaths.find(ent.getDirectoryName());
+        if (old == PathHashTable::NO_ROW)
+            diff.added.push_back(row);
+        else if (!sameRecord(from.getIndex().getEntry(old), ent))
+            diff.changed.push_back(std::make_pair(old, row));
+        else
+            ++diff.unchanged;
+    }
+    for (uint32_t row : oldPaths.getSorted())
+        if (newPaths.find(from.getIndex().getEntry(row).getDirectoryName()) == PathHashTable::NO_ROW)
+            diff.removed.push_back(row);
+}
+
+bool writePatch(const IPFFileSystem &from, const IPFFileSystem &to, const IPFDiff &diff, const std::string &outPath,
+                IPFWriterOptions options, std::vector<std::string> &written, IPFWriteStats &stats, std::string &err)
+{
+    if (options.version_to_patch == 0 && options.new_version == 0)
+    {
+        options.version_to_patch = from.getVersion();
+        options.new_version = to.getVersion();
+    }
+
+    std::vector<uint32_t> rows(diff.added);
+    for (auto &c : diff.changed)
+        rows.push_back(c.second);
+    const IPFIndex &index = to.getIndex();
+    std::sort(rows.begin(), rows.end(), [&index](uint32_t a, uint32_t b)
+              { return comparePathNoCase(index.getEntry(a).getDirectoryName(), index.getEntry(b).getDirectoryName()) < 0; });
+
+    size_t part = 0;
+    for (size_t begin = 0; begin < rows.size() || (begin == 0 && part == 0);)
+    {
+        IPFWriter writer(options);
+        uint64_t bytes = 0;
+        size_t end = begin;
+        for (; end < rows.size() && end - begin < MAX_PATCH_ENTRIES; ++end)
+        {
+            IPFEntryView ent = index.getEntry(rows[end]);
+            if (end > begin && bytes + ent.getFileSizeCompressed() > MAX_PATCH_BYTES)
+                break;
+            bytes += ent.getFileSizeCompressed();
+            writer.addCopy(ent);
+        }
+
+        std::string path = partPath(outPath, part++);
+        if (!writer.write(path, stats, err))
+            return false;
+        written.push_back(path);
+        begin = end;
+        if (begin >= rows.size())
+            break;
+    }
+    return true;
+}
+
+bool applyPatch(const std::string &basePath, const std::string &patchPath, const std::string &outPath,
+                IPFWriterOptions options, IPFWriteStats &stats, std::string &err)
+{
+    IPFIndex base, patch;
+    std::vector<std::string> warnings;
+    if (!readIpfIndexFromPath(basePath, base, warnings))
+    {
+        err = "Failed to read " + basePath;
+        return false;
+    }
+    if (!readIpfIndexFromPath(patchPath, patch, warnings))
+    {
+        err = "Failed to read " + patchPath;
+        return false;
+    }
+
+    const IPFHeader &baseHeader = base.getContainerInfo(0).header;
+    if (options.version_to_patch == 0 && options.new_version == 0)
+    {
+        options.version_to_patch = baseHeader.version_to_patch;
+        options.new_version = std::max(baseHeader.new_version, patch.getContainerInfo(0).header.new_version);
+    }
+    if (options.container_name.empty() && !base.empty())
+        options.container_name = base.getEntry(0).getContainerName().str();
+
+    // Only patch entries of the logical containers this base holds apply to it
+    std::unordered_set<std::string> baseNames;
+    for (uint32_t row = 0; row < base.size(); ++row)
+        baseNames.insert(foldedName(base.getEntry(row).getContainerName()));
+    PathIndex patchPaths;
+    patchPaths.build(patch);
+
+    IPFWriter writer(options);
+    std::vector<char> used(patch.size(), 0);
+    for (uint32_t row = 0; row < base.size(); ++row)
+    {
+        IPFEntryView ent = base.getEntry(row);
+        uint32_t replacement = patchPaths.find(ent.getDirectoryName());
+        if (replacement == PathHashTable::NO_ROW)
+            writer.addCopy(ent);
+        else if (!used[replacement])
+        {
+            writer.addCopy(patch.getEntry(replacement), ent.getRawDirectoryName().str());
+            used[replacement] = 1;
+        }
+    }
+    for (uint32_t row : patchPaths.getSorted())
+    {
+        IPFEntryView ent = patch.getEntry(row);
+        if (!used[row] && baseNames.count(foldedName(ent.getContainerName())))
+            writer.addCopy(ent);
+    }
+    return writer.write(outPath, stats, err);
+}
@@ -0,0 +1,329 @@
+#include "ipf/path_table.hpp"
+#include "ipf/utils.hpp"
+
+#include <algorithm>
+
+const uint32_t PathHashTable::NO_ROW;
+
+uint32_t hashPathNoCase(StringRef path)
+{
+    // FNV-1a over case-folded bytes
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < path.size; ++i)
+    {
+        h ^= static_cast<uint8_t>(foldPathChar(path[i]));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool equalsPathNoCase(StringRef a, StringRef b)
+{
+    if (a.size != b.size)
+        return false;
+    for (size_t i = 0; i < a.size; ++i)
+        if (a[i] != b[i] && foldPathChar(a[i]) != foldPathChar(b[i]))
+            return false;
+    return true;
+}
+
+int comparePathNoCase(StringRef a, StringRef b)
+{
+    size_t n = std::min(a.size, b.size);
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char ca = static_cast<unsigned char>(foldPathChar(a[i]));
+        unsigned char cb = static_cast<unsigned char>(foldPathChar(b[i]));
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    return a.size == b.size ? 0 : (a.size < b.size ? -1 : 1);
+}
+
+int comparePathSuffixNoCase(StringRef a, StringRef b)
+{
+    size_t n = std::min(a.size, b.size);
+    for (size_t i = 1; i <= n; ++i)
+    {
+        unsigned char ca = static_cast<unsigned char>(foldPathChar(a[a.size - i]));
+        unsigned char cb = static_cast<unsigned char>(foldPathChar(b[b.size - i]));
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    return a.size == b.size ? 0 : (a.size < b.size ? -1 : 1);
+}
+
+void PathHashTable::reset(const IPFIndex *index, size_t expectedEntries)
+{
+    owner = index;
+    size_t capacity = 16;
+    while (capacity < expectedEntries * 2)
+        capacity <<= 1;
+    rows.assign(capacity, NO_ROW);
+    hashes.assign(capacity, 0);
+    mask = capacity - 1;
+    count = 0;
+}
+
+void PathHashTable::grow()
+{
+    std::vector<uint32_t> oldRows;
+    oldRows.swap(rows);
+    std::vector<uint32_t> oldHashes;
+    oldHashes.swap(hashes);
+
+    rows.assign(oldRows.size() * 2, NO_ROW);
+    hashes.assign(oldRows.size() * 2, 0);
+    mask = rows.size() - 1;
+
+    for (size_t i = 0; i < oldRows.size(); ++i)
+    {
+        if (oldRows[i] == NO_ROW)
+            continue;
+        size_t slot = oldHashes[i] & mask;
+        while (rows[slot] != NO_ROW)
+            slot = (slot + 1) & mask;
+        rows[slot] = oldRows[i];
+        hashes[slot] = oldHashes[i];
+    }
+}
+
+uint32_t PathHashTable::insertOrReplace(uint32_t row)
+{
+    if (rows.empty())
+        reset(owner, 8);
+    if ((count + 1) * 2 > rows.size())
+        grow();
+
+    StringRef path = owner->getEntry(row).getDirectoryName();
+    uint32_t h = hashPathNoCase(path);
+    size_t slot = h & mask;
+    while (rows[slot] != NO_ROW)
+    {
+        if (hashes[slot] == h && equalsPathNoCase(owner->getEntry(rows[slot]).getDirectoryName(), path))
+        {
+            uint32_t replaced = rows[slot];
+            rows[slot] = row;
+            return replaced;
+        }
+        slot = (slot + 1) & mask;
+    }
+    rows[slot] = row;
+    hashes[slot] = h;
+    ++count;
+    return NO_ROW;
+}
+
+uint32_t PathHashTable::find(StringRef path) const
+{
+    if (rows.empty())
+        return NO_ROW;
+    uint32_t h = hashPathNoCase(path);
+    size_t slot = h & mask;
+    while (rows[slot] != NO_ROW)
+    {
+        if (hashes[slot] == h && equalsPathNoCase(owner->getEntry(rows[slot]).getDirectoryName(), path))
+            return rows[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NO_ROW;
+}
+
+void PathHashTable::serialize(ByteWriter &out) const
+{
+    out.writeLe<uint32_t>(static_cast<uint32_t>(count));
+    out.writeColumn(rows);
+    out.writeColumn(hashes);
+}
+
+bool PathHashTable::deserialize(ByteCursor &in, const IPFIndex *index, std::string &err)
+{
+    uint32_t stored = 0;
+    if (!in.readLe(stored) || !in.readColumn(rows) || !in.readColumn(hashes))
+    {
+        err = "Truncated path table";
+        rows.clear();
+        hashes.clear();
+        return false;
+    }
+
+    owner = index;
+    mask = rows.empty() ? 0 : rows.size() - 1;
+    count = 0;
+    bool valid = hashes.size() == rows.size() && (rows.size() & mask) == 0;
+    for (size_t i = 0; valid && i < rows.size(); ++i)
+    {
+        if (rows[i] == NO_ROW)
+            continue;
+        valid = rows[i] < index->size();
+        ++count;
+    }
+    if (!valid || count != stored)
+    {
+        err = "Inconsistent path table";
+        rows.clear();
+        hashes.clear();
+        count = 0;
+        return false;
+    }
+    return true;
+}
+
+void PathIndex::reset(const IPFIndex *index, size_t expectedEntries)
+{
+    owner = index;
+    table.reset(index, expectedEntries);
+    sorted.clear();
+    sorted_reversed.clear();
+}
+
+void PathIndex::finalize()
+{
+    sorted.clear();
+    sorted.reserve(table.size());
+    table.forEachRow([this](uint32_t r)
+                     { sorted.push_back(r); });
+    std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b)
+              { return comparePathNoCase(pathOf(a), pathOf(b)) < 0; });
+
+    sorted_reversed = sorted;
+    std::sort(sorted_reversed.begin(), sorted_reversed.end(), [this](uint32_t a, uint32_t b)
+              { return comparePathSuffixNoCase(pathOf(a), pathOf(b)) < 0; });
+}
+
+void PathIndex::build(const IPFIndex &index)
+{
+    reset(&index, index.size());
+    for (uint32_t row = 0; row < index.size(); ++row)
+        table.insertOrReplace(row);
+    finalize();
+}
+
+RowRange PathIndex::findPrefix(StringRef prefix) const
+{
+    // Paths sharing a prefix are contiguous in case-folded order
+    auto first = std::partition_point(sorted.begin(), sorted.end(), [&](uint32_t r)
+                                      { return comparePathNoCase(pathOf(r).substr(0, prefix.size), prefix) < 0; });
+    auto last = std::partition_point(first, sorted.end(), [&](uint32_t r)
+                                     { return comparePathNoCase(pathOf(r).substr(0, prefix.size), prefix) == 0; });
+    return RowRange(sorted.data() + (first - sorted.begin()), sorted.data() + (last - sorted.begin()));
+}
+
+RowRange PathIndex::findSuffix(StringRef suffix) const
+{
+    auto tail = [&](uint32_t r)
+    {
+        StringRef p = pathOf(r);
+        return p.substr(p.size - std::min(p.size, suffix.size));
+    };
+    auto first = std::partition_point(sorted_reversed.begin(), sorted_reversed.end(), [&](uint32_t r)
+                                      { return comparePathSuffixNoCase(tail(r), suffix) < 0; });
+    auto last = std::partition_point(first, sorted_reversed.end(), [&](uint32_t r)
+                                     { return comparePathSuffixNoCase(tail(r), suffix) == 0; });
+    return RowRange(sorted_reversed.data() + (first - sorted_reversed.begin()),
+                    sorted_reversed.data() + (last - sorted_reversed.begin()));
+}
+
+void PathIndex::listDirectory(StringRef dir, std::vector<StringRef> &subdirs, std::vector<uint32_t> &files) const
+{
+    while (!dir.empty() && dir[0] == '/')
+        dir = dir.substr(1);
+    std::string prefix = dir.str();
+    if (!prefix.empty() && prefix.back() != '/')
+        prefix.push_back('/');
+
+    RowRange range = findPrefix(StringRef(prefix));
+    std::string skip;
+    for (const uint32_t *it = range.begin(); it != range.end();)
+    {
+        StringRef rest = pathOf(*it).substr(prefix.size());
+        size_t slash = 0;
+        while (slash < rest.size && rest[slash] != '/')
+            ++slash;
+        if (slash == rest.size)
+        {
+            files.push_back(*it++);
+            continue;
+        }
+
+        // Jump over the whole subtree instead of walking it. Most subtrees are
+        // small, so gallop ahead before bisecting rather than bisecting the
+        // rest of the range for every subdirectory.
+        StringRef name = rest.substr(0, slash);
+        subdirs.push_back(name);
+        skip = prefix;
+        skip.append(name.data, name.size);
+        skip.push_back('/');
+        auto inSubtree = [&](uint32_t r)
+        { return comparePathNoCase(pathOf(r).substr(0, skip.size()), StringRef(skip)) <= 0; };
+        const uint32_t *low = it + 1;
+        size_t stride = 1;
+        while (stride <= static_cast<size_t>(range.end() - low) && inSubtree(low[stride - 1]))
+        {
+            low += stride;
+            stride *= 2;
+        }
+        it = std::partition_point(low, low + std::min(stride, static_cast<size_t>(range.end() - low)), inSubtree);
+    }
+}
+
+void PathIndex::glob(StringRef pattern, std::vector<uint32_t> &out) const
+{
+    size_t head = 0;
+    while (head < pattern.size && pattern[head] != '*' && pattern[head] != '?')
+        ++head;
+    if (head == pattern.size)
+    {
+        uint32_t row = find(pattern);
+        if (row != PathHashTable::NO_ROW)
+            out.push_back(row);
+        return;
+    }
+    size_t tail = pattern.size;
+    while (tail > head && pattern[tail - 1] != '*' && pattern[tail - 1] != '?')
+        --tail;
+
+    RowRange byPrefix = findPrefix(pattern.substr(0, head));
+    RowRange bySuffix = findSuffix(pattern.substr(tail));
+    bool usePrefix = byPrefix.size() <= bySuffix.size();
+    RowRange candidates = usePrefix ? byPrefix : bySuffix;
+
+    size_t start = out.size();
+    for (uint32_t r : candidates)
+        if (matchGlob(pattern, pathOf(r)))
+            out.push_back(r);
+    if (!usePrefix)
+        std::sort(out.begin() + start, out.end(), [this](uint32_t a, uint32_t b)
+                  { return comparePathNoCase(pathOf(a), pathOf(b)) < 0; });
+}
+
+void PathIndex::serialize(ByteWriter &out) const
+{
+    table.serialize(out);
+    out.writeColumn(sorted);
+    out.writeColumn(sorted_reversed);
+}
+
+bool PathIndex::deserialize(ByteCursor &in, const IPFIndex *index, std::string &err)
+{
+    owner = index;
+    if (!table.deserialize(in, index, err))
+        return false;
+    if (!in.readColumn(sorted) || !in.readColumn(sorted_reversed) || sorted.size() != table.size() ||
+        sorted_reversed.size() != table.size())
+    {
+        err = "Inconsistent path order";
+        reset(index, 0);
+        return false;
+    }
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        if (sorted[i] >= index->size() || sorted_reversed[i] >= index->size())
+        {
+            err = "Path order refers to a missing row";
+            reset(index, 0);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,309 @@
+#include "ipf/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const char *getTraceCategoryName(TraceCategory category)
+{
+    switch (category)
+    {
+    case TraceCategory::Open:
+        return "open";
+    case TraceCategory::Parse:
+        return "parse";
+    case TraceCategory::Read:
+        return "read";
+    case TraceCategory::Decrypt:
+        return "decrypt";
+    case TraceCategory::Inflate:
+        return "inflate";
+    case TraceCategory::Verify:
+        return "verify";
+    case TraceCategory::Write:
+        return "write";
+    case TraceCategory::Extract:
+        return "extract";
+    default:
+        return "unknown";
+    }
+}
+
+#if defined(KLAIPEDA_TRACE)
+
+namespace
+{
+    const size_t CATEGORY_COUNT = static_cast<size_t>(TraceCategory::Count);
+    const size_t HISTOGRAM_BUCKETS = 40; // bucket i holds durations in [2^i, 2^(i+1)) ns
+
+    struct TraceEvent
+    {
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        uint64_t bytes;
+        TraceCategory category;
+    };
+
+    struct CategoryStats
+    {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t bytes = 0;
+        uint64_t histogram[HISTOGRAM_BUCKETS] = {};
+
+        void add(const CategoryStats &o)
+        {
+            count += o.count;
+            total_ns += o.total_ns;
+            bytes += o.bytes;
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+                histogram[i] += o.histogram[i];
+        }
+    };
+
+    // Written only by its own thread; the registry owns it so it outlives the thread.
+    struct ThreadTrace
+    {
+        uint32_t thread_id = 0;
+        std::vector<TraceEvent> ring;
+        std::atomic<uint64_t> recorded{0};
+        CategoryStats stats[CATEGORY_COUNT];
+    };
+
+    struct TraceRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadTrace>> threads;
+        std::atomic<bool> enabled{false};
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    TraceRegistry &getRegistry()
+    {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    ThreadTrace &getThreadTrace()
+    {
+        static thread_local ThreadTrace *current = nullptr;
+        if (!current)
+        {
+            TraceRegistry &registry = getRegistry();
+            std::unique_ptr<ThreadTrace> trace(new ThreadTrace());
+            trace->ring.resize(TRACE_RING_CAPACITY);
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            trace->thread_id = static_cast<uint32_t>(registry.threads.size() + 1);
+            current = trace.get();
+            registry.threads.push_back(std::move(trace));
+        }
+        return *current;
+    }
+
+    // Nanoseconds since the registry was created, never 0 so 0 can mean "not started"
+    uint64_t nowNs()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - getRegistry().epoch;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) + 1;
+    }
+
+    size_t bucketOf(uint64_t ns)
+    {
+        size_t bucket = 0;
+        while (ns > 1 && bucket + 1 < HISTOGRAM_BUCKETS)
+        {
+            ns >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    std::string formatNs(double ns)
+    {
+        char buf[32];
+        if (ns < 1e3)
+            std::snprintf(buf, sizeof(buf), "%.0fns", ns);
+        else if (ns < 1e6)
+            std::snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+        else if (ns < 1e9)
+            std::snprintf(buf, sizeof(buf), "%.2fms", ns / 1e6);
+        else
+            std::snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+        return buf;
+    }
+
+    // Upper bound of the bucket holding the given fraction of samples
+    double percentileNs(const CategoryStats &stats, double fraction)
+    {
+        uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(stats.count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            seen += stats.histogram[i];
+            if (seen > target)
+                return static_cast<double>(2ull << i);
+        }
+        return static_cast<double>(2ull << (HISTOGRAM_BUCKETS - 1));
+    }
+}
+
+TraceScope::TraceScope(TraceCategory category, uint64_t bytes)
+    : category(category), bytes(bytes), start_ns(isTracingEnabled() ? nowNs() : 0)
+{
+}
+
+TraceScope::~TraceScope()
+{
+    if (start_ns == 0)
+        return;
+    uint64_t duration = nowNs() - start_ns;
+
+    ThreadTrace &trace = getThreadTrace();
+    CategoryStats &stats = trace.stats[static_cast<size_t>(category)];
+    ++stats.count;
+    stats.total_ns += duration;
+    stats.bytes += bytes;
+    ++stats.histogram[bucketOf(duration)];
+
+    uint64_t slot = trace.recorded.load(std::memory_order_relaxed);
+    trace.ring[slot % TRACE_RING_CAPACITY] = TraceEvent{start_ns, duration, bytes, category};
+    trace.recorded.store(slot + 1, std::memory_order_release);
+}
+
+void setTracingEnabled(bool enabled) { getRegistry().enabled.store(enabled, std::memory_order_relaxed); }
+
+bool isTracingEnabled() { return getRegistry().enabled.load(std::memory_order_relaxed); }
+
+void resetTrace()
+{
+    TraceRegistry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &t : registry.threads)
+    {
+        t->recorded.store(0, std::memory_order_relaxed);
+        for (auto &s : t->stats)
+            s = CategoryStats();
+    }
+}
+
+bool writeChromeTrace(const std::string &path, std::string &err)
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        err = "Failed to open " + path;
+        return false;
+    }
+
+    TraceRegistry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (auto &t : registry.threads)
+    {
+        std::fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                     first ? "" : ",", t->thread_id, t->thread_id);
+        first = false;
+
+        // Oldest surviving event first
+        uint64_t recorded = t->recorded.load(std::memory_order_acquire);
+        uint64_t begin = recorded > TRACE_RING_CAPACITY ? recorded - TRACE_RING_CAPACITY : 0;
+        for (uint64_t i = begin; i < recorded; ++i)
+        {
+            const TraceEvent &e = t->ring[i % TRACE_RING_CAPACITY];
+            std::fprintf(f,
+                         ",\n{\"name\":\"%s\",\"cat\":\"ipf\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                         "\"args\":{\"bytes\":%llu}}",
+                         getTraceCategoryName(e.category), t->thread_id, static_cast<double>(e.start_ns) / 1e3,
+                         static_cast<double>(e.duration_ns) / 1e3, static_cast<unsigned long long>(e.bytes));
+        }
+    }
+    std::fprintf(f, "\n]}\n");
+    if (std::fclose(f) != 0)
+    {
+        err = "Failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::string getTraceSummary()
+{
+    CategoryStats total[CATEGORY_COUNT];
+    size_t threads = 0;
+    {
+        TraceRegistry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        threads = registry.threads.size();
+        for (auto &t : registry.threads)
+            for (size_t c = 0; c < CATEGORY_COUNT; ++c)
+                total[c].add(t->stats[c]);
+    }
+
+    std::string out;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%-8s %10s %10s %10s %10s %10s %10s %10s  (%zu threads)\n", "category", "count",
+                  "total", "mean", "MB", "p50", "p90", "p99", threads);
+    out += buf;
+    for (size_t c = 0; c < CATEGORY_COUNT; ++c)
+    {
+        const CategoryStats &s = total[c];
+        if (s.count == 0)
+            continue;
+        std::snprintf(buf, sizeof(buf), "%-8s %10llu %10s %10s %10.1f %10s %10s %10s\n",
+                      getTraceCategoryName(static_cast<TraceCategory>(c)), static_cast<unsigned long long>(s.count),
+                      formatNs(static_cast<double>(s.total_ns)).c_str(),
+                      formatNs(static_cast<double>(s.total_ns) / static_cast<double>(s.count)).c_str(),
+                      static_cast<double>(s.bytes) / (1024.0 * 1024.0), formatNs(percentileNs(s, 0.5)).c_str(),
+                      formatNs(percentileNs(s, 0.9)).c_str(), formatNs(percentileNs(s, 0.99)).c_str());
+        out += buf;
+    }
+
+    // One bar chart per category over the occupied log2 buckets
+    const int BAR_WIDTH = 40;
+    for (size_t c = 0; c < CATEGORY_COUNT; ++c)
+    {
+        const CategoryStats &s = total[c];
+        if (s.count == 0)
+            continue;
+        size_t lo = HISTOGRAM_BUCKETS, hi = 0;
+        uint64_t peak = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+            if (s.histogram[i])
+            {
+                lo = std::min(lo, i);
+                hi = i;
+                peak = std::max(peak, s.histogram[i]);
+            }
+        out += std::string("\n") + getTraceCategoryName(static_cast<TraceCategory>(c)) + "\n";
+        for (size_t i = lo; i <= hi; ++i)
+        {
+            int width = static_cast<int>(s.histogram[i] * BAR_WIDTH / peak);
+            std::snprintf(buf, sizeof(buf), "  < %-8s %-*s %llu\n", formatNs(static_cast<double>(2ull << i)).c_str(),
+                          BAR_WIDTH, std::string(static_cast<size_t>(width), '#').c_str(),
+                          static_cast<unsigned long long>(s.histogram[i]));
+            out += buf;
+        }
+    }
+    return out;
+}
+
+#else
+
+void setTracingEnabled(bool) {}
+bool isTracingEnabled() { return false; }
+void resetTrace() {}
+
+bool writeChromeTrace(const std::string &, std::string &err)
+{
+    err = "Tracing is not compiled in (build with KLAIPEDA_TRACE)";
+    return false;
+}
+
+std::string getTraceSummary() { return "Tracing is not compiled in (build with KLAIPEDA_TRACE)\n"; }
+
+#endif // KLAIPEDA_TRACE
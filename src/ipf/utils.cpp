@@ -1,34 +1,30 @@
 #include "ipf/utils.hpp"
+#include "ipf/hex_dump.hpp"
+#include "ipf/trace.hpp"
 
 #include <iostream>
-#include <iomanip>
-#include <cctype>
+#include <cerrno>
+#include <cstdio>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <direct.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 
 void printHexViewer(const std::vector<uint8_t> &data)
 {
-    const size_t BYTES_PER_LINE = 16;
-    for (size_t i = 0; i < data.size(); i += BYTES_PER_LINE)
-    {
-        std::cout << std::setw(8) << std::setfill('0') << i << "  ";
-        for (size_t j = 0; j < BYTES_PER_LINE; ++j)
-        {
-            if (i + j < data.size())
-                std::cout << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
-                          << (int)data[i + j] << " ";
-            else
-                std::cout << "   ";
-        }
-        std::cout << " ";
-        for (size_t j = 0; j < BYTES_PER_LINE && i + j < data.size(); ++j)
-        {
-            unsigned char c = data[i + j];
-            if (std::isprint(c) || c == ' ')
-                std::cout << (char)c;
-            else
-                std::cout << '.';
-        }
-        std::cout << std::dec << "\n";
-    }
+    std::cout.flush();
+    writeHexDump(ByteSpan(data.data(), data.size()), stdout);
 }
 
 void logInfo(const std::string &msg)
@@ -43,3 +39,229 @@ void logError(const std::string &msg)
 {
     std::cerr << "[ERROR] " << msg << "\n";
 }
+
+static inline char foldCase(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+bool matchGlob(StringRef pattern, StringRef text)
+{
+    // Iterative matcher with single-star backtracking: linear for the usual "*.ies" / "xml/*" shapes.
+    size_t p = 0, t = 0;
+    size_t starP = std::string::npos, starT = 0;
+    while (t < text.size)
+    {
+        if (p < pattern.size && (pattern[p] == '?' || foldCase(pattern[p]) == foldCase(text[t])))
+        {
+            ++p;
+            ++t;
+        }
+        else if (p < pattern.size && pattern[p] == '*')
+        {
+            starP = p++;
+            starT = t;
+        }
+        else if (starP != std::string::npos)
+        {
+            p = starP + 1;
+            t = ++starT;
+        }
+        else
+            return false;
+    }
+    while (p < pattern.size && pattern[p] == '*')
+        ++p;
+    return p == pattern.size;
+}
+
+static bool makeDirectory(const std::string &path)
+{
+#if defined(_WIN32)
+    int rc = _mkdir(path.c_str());
+#else
+    int rc = mkdir(path.c_str(), 0755);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+bool createDirectories(const std::string &path)
+{
+    if (path.empty())
+        return true;
+    for (size_t i = 1; i < path.size(); ++i)
+    {
+        if (path[i] != '/' && path[i] != '\\')
+            continue;
+        if (path[i - 1] == ':') // drive root on Windows
+            continue;
+        if (!makeDirectory(path.substr(0, i)))
+            return false;
+    }
+    return makeDirectory(path);
+}
+
+bool writeFileBytes(const std::string &path, const uint8_t *data, size_t size)
+{
+    IPF_TRACE_SCOPE_BYTES(Write, size);
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = size == 0 || std::fwrite(data, 1, size, f) == size;
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
+
+bool getFileStamp(const std::string &path, FileStamp &out)
+{
+#if defined(_WIN32)
+    // _stat64 stops at whole seconds; the last write time is in 100ns ticks since 1601
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+        return false;
+    uint64_t ticks = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    out.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    out.mtime = static_cast<int64_t>(ticks / 10000000u) - 11644473600LL;
+    out.mtime_ns = static_cast<uint32_t>(ticks % 10000000u) * 100u;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.mtime = static_cast<int64_t>(st.st_mtime);
+#if defined(__APPLE__)
+    out.mtime_ns = static_cast<uint32_t>(st.st_mtimespec.tv_nsec);
+#else
+    out.mtime_ns = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+#endif
+#endif
+    return true;
+}
+
+bool replaceFile(const std::string &from, const std::string &to)
+{
+#if defined(_WIN32)
+    // rename does not overwrite on Windows
+    std::remove(to.c_str());
+#endif
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool replaceFileBytes(const std::string &path, const uint8_t *data, size_t size)
+{
+    std::string temp = path + ".tmp";
+    if (!writeFileBytes(temp, data, size))
+    {
+        std::remove(temp.c_str());
+        return false;
+    }
+    if (!replaceFile(temp, path))
+    {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool copyFileBytes(const std::string &from, const std::string &to)
+{
+    FILE *in = std::fopen(from.c_str(), "rb");
+    if (!in)
+        return false;
+    FILE *out = std::fopen(to.c_str(), "wb");
+    if (!out)
+    {
+        std::fclose(in);
+        return false;
+    }
+    std::vector<char> buf(1u << 16);
+    bool ok = true;
+    size_t n;
+    while ((n = std::fread(buf.data(), 1, buf.size(), in)) > 0)
+        if (std::fwrite(buf.data(), 1, n, out) != n)
+        {
+            ok = false;
+            break;
+        }
+    ok = !std::ferror(in) && ok;
+    std::fclose(in);
+    ok = (std::fclose(out) == 0) && ok;
+    return ok;
+}
+
+bool linkOrCopyFile(const std::string &from, const std::string &to)
+{
+    std::remove(to.c_str());
+#if defined(_WIN32)
+    if (CreateHardLinkA(to.c_str(), from.c_str(), NULL))
+        return true;
+#else
+    if (link(from.c_str(), to.c_str()) == 0)
+        return true;
+#endif
+    return copyFileBytes(from, to);
+}
+
+static bool hasExtensionNoCase(const std::string &name, const std::string &extension)
+{
+    if (name.size() < extension.size())
+        return false;
+    for (size_t i = 0; i < extension.size(); ++i)
+        if (foldCase(name[name.size() - extension.size() + i]) != foldCase(extension[i]))
+            return false;
+    return true;
+}
+
+bool listFilesRecursive(const std::string &dir, const std::string &extension, std::vector<std::string> &out)
+{
+#if defined(_WIN32)
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dir + "\\*").c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        std::string name = fd.cFileName;
+        if (name == "." || name == "..")
+            continue;
+        std::string full = dir + "/" + name;
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            listFilesRecursive(full, extension, out);
+        else if (hasExtensionNoCase(name, extension))
+            out.push_back(full);
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+    return true;
+#else
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return false;
+    while (dirent *e = readdir(d))
+    {
+        std::string name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string full = dir + "/" + name;
+        struct stat st;
+        if (stat(full.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            listFilesRecursive(full, extension, out);
+        else if (S_ISREG(st.st_mode) && hasExtensionNoCase(name, extension))
+            out.push_back(full);
+    }
+    closedir(d);
+    return true;
+#endif
+}
+
+bool isDirectory(const std::string &path)
+{
+#if defined(_WIN32)
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
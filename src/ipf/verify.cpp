@@ -0,0 +1,114 @@
+#include "ipf/verify.hpp"
+#include "ipf/bulk_extract.hpp"
+#include "ipf/crc32.hpp"
+#include "ipf/ipf_container.hpp"
+#include "ipf/trace.hpp"
+#include "ipf/utils.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+bool checkStoredCrc(uint32_t expected, uint32_t actual, std::string &err)
+{
+    if (expected == actual)
+        return true;
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "CRC mismatch: stored 0x%08X, computed 0x%08X", expected, actual);
+    err = buf;
+    return false;
+}
+
+bool verifyStoredBytes(ByteSpan stored, uint32_t expected, std::string &err)
+{
+    IPF_TRACE_SCOPE_BYTES(Verify, stored.size);
+    return checkStoredCrc(expected, crc32Compute(stored), err);
+}
+
+namespace
+{
+    bool verifyPayload(const IPFEntryView &ent, std::vector<uint8_t> &buffer, std::string &err)
+    {
+        const std::shared_ptr<IPFContainer> &container = ent.getContainer();
+        if (!container)
+        {
+            err = "Container not open: " + ent.getFilePath();
+            return false;
+        }
+
+        ByteSpan stored;
+        if (!container->getSpan(ent.getFilePointer(), ent.getFileSizeCompressed(), stored))
+        {
+            if (!container->readBytes(ent.getFilePointer(), ent.getFileSizeCompressed(), buffer, err))
+                return false;
+            stored = ByteSpan(buffer.data(), buffer.size());
+        }
+        return verifyStoredBytes(stored, ent.getCrc32(), err);
+    }
+}
+
+bool verifyEntry(const IPFEntryView &ent, std::string &err)
+{
+    std::vector<uint8_t> buffer;
+    return verifyPayload(ent, buffer, err);
+}
+
+double VerifyStats::getMegabytesPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+std::string VerifyStats::toString() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%llu entries (%llu failed) in %.2fs: %.1f MB/s [%s]",
+                  static_cast<unsigned long long>(entries), static_cast<unsigned long long>(failures), seconds,
+                  getMegabytesPerSecond(), getCrc32Implementation());
+    return buf;
+}
+
+bool verifyAll(const IPFIndex &index, size_t threadCount, VerifyStats &stats)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> rows(index.size());
+    for (uint32_t i = 0; i < rows.size(); ++i)
+        rows[i] = i;
+    std::sort(rows.begin(), rows.end(), [&index](uint32_t a, uint32_t b)
+              {
+        IPFEntryView ea = index.getEntry(a);
+        IPFEntryView eb = index.getEntry(b);
+        if (ea.getContainerId() != eb.getContainerId())
+            return ea.getContainerId() < eb.getContainerId();
+        return ea.getFilePointer() < eb.getFilePointer(); });
+
+    std::atomic<uint64_t> entries{0}, failures{0}, bytes{0};
+    std::mutex errorMutex;
+
+    size_t threads = threadCount ? threadCount : std::thread::hardware_concurrency();
+    {
+        ThreadPool pool(std::max<size_t>(1, threads), SchedulingMode::WorkStealing);
+        parallelForEntries(pool, index, rows, 8u << 20, [&](const IPFEntryView &ent)
+                           {
+            static thread_local std::vector<uint8_t> buffer;
+            std::string err;
+            if (!verifyPayload(ent, buffer, err)) {
+                failures.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(errorMutex);
+                stats.errors.push_back(ent.getDirectoryName().str() + ": " + err);
+            }
+            entries.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(ent.getFileSizeCompressed(), std::memory_order_relaxed); });
+    }
+
+    stats.entries += entries.load();
+    stats.failures += failures.load();
+    stats.bytes += bytes.load();
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    logInfo("Verified " + stats.toString());
+    return failures.load() == 0;
+}
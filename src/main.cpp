@@ -1,15 +1,376 @@
+#include "ipf/bulk_extract.hpp"
+#include "ipf/dedup.hpp"
+#include "ipf/hex_dump.hpp"
 #include "ipf/ipf_reader.hpp"
+#include "ipf/ipf_vfs.hpp"
+#include "ipf/ipf_writer.hpp"
+#include "ipf/patch.hpp"
+#include "ipf/trace.hpp"
 #include "ipf/utils.hpp"
+#include "ipf/verify.hpp"
+#include "viewer/viewer_app.hpp"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <vector>
 #include <string>
-#include <filesystem>
 #include <thread>
 
-int main()
+static bool loadIndex(const std::string &path, IPFIndex &index)
+{
+    std::vector<std::string> warnings;
+    bool ok = readIpfIndexFromPath(path, index, warnings);
+    for (auto &w : warnings)
+        logWarn(w);
+    if (!ok)
+        logError("Failed reading IPF root");
+    return ok;
+}
+
+static int runBulkExtract(const std::string &path, int argc, char **argv, int argi)
+{
+    BulkExtractOptions options;
+    options.output_dir = argv[argi++];
+    if (argi < argc && argv[argi][0] != '-')
+        options.pattern = argv[argi++];
+    for (; argi < argc; ++argi)
+    {
+        std::string arg = argv[argi];
+        if (arg == "--threads" && argi + 1 < argc)
+            options.thread_count = static_cast<size_t>(std::stoul(argv[++argi]));
+        else if (arg == "--verify")
+            options.verify_crc = true;
+        else if (arg == "--dedup")
+            options.dedup = true;
+        else if (arg == "--batched-reads")
+            options.batched_reads = true;
+        else if (arg == "--queue-depth" && argi + 1 < argc)
+            options.read_queue_depth = static_cast<unsigned>(std::stoul(argv[++argi]));
+    }
+
+    IPFIndex index;
+    if (!loadIndex(path, index))
+        return 1;
+
+    BulkExtractStats stats;
+    bool extracted = extractAll(index, options, stats);
+    for (auto &e : stats.errors)
+        logWarn(e);
+    return extracted ? 0 : 1;
+}
+
+static int runVerify(const std::string &path)
+{
+    IPFIndex index;
+    if (!loadIndex(path, index))
+        return 1;
+
+    VerifyStats stats;
+    bool verified = verifyAll(index, 0, stats);
+    for (auto &e : stats.errors)
+        logWarn(e);
+    return verified ? 0 : 1;
+}
+
+static int runDedupReport(const std::string &path)
+{
+    // A data directory is mounted so duplicates across patch containers show up too
+    IPFFileSystem fs;
+    IPFIndex single;
+    const IPFIndex *index = &single;
+    if (isDirectory(path))
+    {
+        std::vector<std::string> warnings;
+        bool mounted = fs.mount(path, warnings);
+        for (auto &w : warnings)
+            logWarn(w);
+        if (!mounted)
+            return 1;
+        index = &fs.getIndex();
+    }
+    else if (!loadIndex(path, single))
+        return 1;
+
+    DedupReport report;
+    findDuplicates(*index, selectEntries(*index, std::string()), report);
+    std::vector<const DedupGroup *> groups;
+    for (auto &g : report.groups)
+        groups.push_back(&g);
+    std::sort(groups.begin(), groups.end(), [index](const DedupGroup *a, const DedupGroup *b)
+              { return (a->rows.size() - 1) * index->getEntry(a->rows[0]).getFileSizeUncompressed() >
+                       (b->rows.size() - 1) * index->getEntry(b->rows[0]).getFileSizeUncompressed(); });
+    for (size_t i = 0; i < groups.size() && i < 20; ++i)
+    {
+        IPFEntryView first = index->getEntry(groups[i]->rows[0]);
+        std::cout << groups[i]->rows.size() << "x " << first.getFileSizeUncompressed() << " bytes: "
+                  << first.getDirectoryName().str() << "\n";
+    }
+    logInfo("Dedup: " + report.toString());
+    return 0;
+}
+
+static int runMount(const std::string &dataDir, int argc, char **argv, int argi)
+{
+    std::string name, cachePath, hexOut;
+    for (; argi < argc; ++argi)
+    {
+        std::string arg = argv[argi];
+        if (arg == "--cache" && argi + 1 < argc)
+            cachePath = argv[++argi];
+        else if (arg == "--hex-out" && argi + 1 < argc)
+            hexOut = argv[++argi];
+        else
+            name = arg;
+    }
+
+    IPFFileSystem fs;
+    std::vector<std::string> warnings;
+    bool mounted = cachePath.empty() ? fs.mount(dataDir, warnings) : fs.mountCached(dataDir, cachePath, warnings);
+    for (auto &w : warnings)
+        logWarn(w);
+    if (!mounted)
+        return 1;
+    if (name.empty())
+        return 0;
+
+    // "dir/" lists a directory, a glob lists its matches, anything else is dumped
+    const PathIndex &paths = fs.getPaths();
+    if (name.back() == '/')
+    {
+        std::vector<StringRef> subdirs;
+        std::vector<uint32_t> files;
+        paths.listDirectory(StringRef(name), subdirs, files);
+        for (auto &d : subdirs)
+            std::cout << d.str() << "/\n";
+        for (uint32_t r : files)
+            std::cout << fs.getIndex().getEntry(r).getDirectoryName().str() << "\n";
+        return 0;
+    }
+    if (name.find_first_of("*?") != std::string::npos)
+    {
+        for (uint32_t r : selectEntries(paths, name))
+            std::cout << fs.getIndex().getEntry(r).getDirectoryName().str() << "\n";
+        return 0;
+    }
+
+    IPFEntryView ent;
+    if (!fs.find(StringRef(name), ent))
+    {
+        logError("Not found: " + name);
+        return 1;
+    }
+    std::string err;
+    if (!hexOut.empty())
+    {
+        if (!writeHexDumpToPath(ent, hexOut, err))
+        {
+            logError("Hex dump failed: " + err);
+            return 1;
+        }
+        logInfo("Wrote hex dump of " + ent.getDirectoryName().str() + " to " + hexOut);
+        return 0;
+    }
+    std::vector<uint8_t> data, scratch;
+    if (!extractFileData(ent, data, scratch, err))
+    {
+        logError("Extraction failed: " + err);
+        return 1;
+    }
+    logInfo("=== " + ent.getDirectoryName().str() + " FROM " + ent.getFilePath() + " ===");
+    printHexViewer(data);
+    return 0;
+}
+
+// Files below dir with their names relative to it, '/'-separated.
+static void listRelativeFiles(const std::string &dir, std::vector<std::pair<std::string, std::string>> &out)
+{
+    std::vector<std::string> files;
+    listFilesRecursive(dir, "", files);
+    for (auto &f : files)
+    {
+        std::string name = f.substr(dir.size() + 1);
+        for (auto &c : name)
+            if (c == '\\')
+                c = '/';
+        out.push_back(std::make_pair(name, f));
+    }
+    std::sort(out.begin(), out.end());
+}
+
+static void parseWriterOptions(int argc, char **argv, int argi, IPFWriterOptions &options, std::string &modDir)
+{
+    for (; argi < argc; ++argi)
+    {
+        std::string arg = argv[argi];
+        if (arg == "--threads" && argi + 1 < argc)
+            options.thread_count = static_cast<size_t>(std::stoul(argv[++argi]));
+        else if (arg == "--level" && argi + 1 < argc)
+            options.compression_level = std::stoi(argv[++argi]);
+        else if (arg == "--name" && argi + 1 < argc)
+            options.container_name = argv[++argi];
+        else if (arg == "--version" && argi + 1 < argc)
+            options.new_version = static_cast<uint32_t>(std::stoul(argv[++argi]));
+        else if (arg == "--mod-dir" && argi + 1 < argc)
+            modDir = argv[++argi];
+    }
+}
+
+static int runPack(const std::string &sourceDir, int argc, char **argv, int argi)
+{
+    std::string outPath = argv[argi++];
+    IPFWriterOptions options;
+    std::string unused;
+    parseWriterOptions(argc, argv, argi, options, unused);
+
+    std::vector<std::pair<std::string, std::string>> files;
+    listRelativeFiles(sourceDir, files);
+    IPFWriter writer(options);
+    for (auto &f : files)
+        writer.addFileFromPath(f.first, f.second);
+
+    IPFWriteStats stats;
+    std::string err;
+    if (!writer.write(outPath, stats, err))
+    {
+        logError("Pack failed: " + err);
+        return 1;
+    }
+    logInfo("Packed " + stats.toString());
+    return 0;
+}
+
+static int runRepack(const std::string &inPath, int argc, char **argv, int argi)
+{
+    std::string outPath = argv[argi++];
+    IPFWriterOptions options;
+    std::string modDir;
+    parseWriterOptions(argc, argv, argi, options, modDir);
+
+    // Every file under the mod directory replaces or adds the entry of the same name
+    std::map<std::string, std::vector<uint8_t>> changes;
+    std::vector<std::pair<std::string, std::string>> files;
+    if (!modDir.empty())
+        listRelativeFiles(modDir, files);
+    for (auto &f : files)
+    {
+        std::ifstream in(f.second, std::ios::binary);
+        changes[f.first].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    IPFWriteStats stats;
+    std::string err;
+    if (!repackContainer(inPath, outPath, std::move(changes), std::vector<std::string>(), options, stats, err))
+    {
+        logError("Repack failed: " + err);
+        return 1;
+    }
+    logInfo("Repacked " + stats.toString());
+    return 0;
+}
+
+static int runDiff(const std::string &oldDir, int argc, char **argv, int argi)
+{
+    std::string newDir = argv[argi++];
+    std::string patchPath;
+    for (; argi < argc; ++argi)
+    {
+        std::string arg = argv[argi];
+        if (arg == "--patch" && argi + 1 < argc)
+            patchPath = argv[++argi];
+    }
+
+    IPFFileSystem from, to;
+    std::vector<std::string> warnings;
+    bool mounted = from.mount(oldDir, warnings) && to.mount(newDir, warnings);
+    for (auto &w : warnings)
+        logWarn(w);
+    if (!mounted)
+        return 1;
+
+    IPFDiff diff;
+    diffFileSystems(from, to, diff);
+    for (uint32_t r : diff.added)
+        std::cout << "A " << to.getIndex().getEntry(r).getDirectoryName().str() << "\n";
+    for (auto &c : diff.changed)
+        std::cout << "M " << to.getIndex().getEntry(c.second).getDirectoryName().str() << "\n";
+    for (uint32_t r : diff.removed)
+        std::cout << "D " << from.getIndex().getEntry(r).getDirectoryName().str() << "\n";
+    logInfo("Diff " + std::to_string(from.getVersion()) + " -> " + std::to_string(to.getVersion()) + ": " + diff.toString());
+    if (patchPath.empty())
+        return 0;
+
+    if (!diff.removed.empty())
+        logWarn("IPF cannot express deletions, " + std::to_string(diff.removed.size()) + " removed entries are not in the patch");
+    std::vector<std::string> written;
+    IPFWriteStats stats;
+    std::string err;
+    if (!writePatch(from, to, diff, patchPath, IPFWriterOptions(), written, stats, err))
+    {
+        logError("Patch failed: " + err);
+        return 1;
+    }
+    for (auto &w : written)
+        logInfo("Wrote " + w);
+    logInfo("Patch " + stats.toString());
+    return 0;
+}
+
+static int runApply(const std::string &basePath, int argc, char **argv, int argi)
+{
+    std::string patchPath = argv[argi++];
+    std::string outPath = argv[argi++];
+    IPFWriterOptions options;
+    std::string unused;
+    parseWriterOptions(argc, argv, argi, options, unused);
+
+    IPFWriteStats stats;
+    std::string err;
+    if (!applyPatch(basePath, patchPath, outPath, options, stats, err))
+    {
+        logError("Apply failed: " + err);
+        return 1;
+    }
+    logInfo("Applied " + stats.toString());
+    return 0;
+}
+
+static int runCommand(int argc, char **argv)
 {
 
     std::string path = "C:\\Users\\Ridwan Hidayatullah\\Documents\\TreeOfSaviorCN\\data\\xml_tree.ipf";
+    if (argc > 1)
+        path = argv[1];
+
+    // klaipeda <file.ipf> --extract <out_dir> [glob] [--threads N] [--verify] [--dedup] [--batched-reads] [--queue-depth N]
+    if (argc > 3 && std::string(argv[2]) == "--extract")
+        return runBulkExtract(path, argc, argv, 3);
+    // klaipeda <data_dir | file.ipf> --view [--cache <index_file>]
+    if (argc > 2 && std::string(argv[2]) == "--view")
+        return runViewer(path, argc > 4 && std::string(argv[3]) == "--cache" ? argv[4] : std::string());
+    // klaipeda <data_dir> --mount [logical/path | dir/ | glob] [--cache <index_file>] [--hex-out <dump.txt>]
+    if (argc > 2 && std::string(argv[2]) == "--mount")
+        return runMount(path, argc, argv, 3);
+    // klaipeda <source_dir> --pack <out.ipf> [--name xml.ipf] [--version N] [--level L] [--threads N]
+    if (argc > 3 && std::string(argv[2]) == "--pack")
+        return runPack(path, argc, argv, 3);
+    // klaipeda <file.ipf> --repack <out.ipf> [--mod-dir dir] [--level L] [--threads N]
+    if (argc > 3 && std::string(argv[2]) == "--repack")
+        return runRepack(path, argc, argv, 3);
+    // klaipeda <old_data_dir> --diff <new_data_dir> [--patch <out.ipf>]
+    if (argc > 3 && std::string(argv[2]) == "--diff")
+        return runDiff(path, argc, argv, 3);
+    // klaipeda <base.ipf> --apply <patch.ipf> <out.ipf> [--threads N]
+    if (argc > 4 && std::string(argv[2]) == "--apply")
+        return runApply(path, argc, argv, 3);
+    // klaipeda <file.ipf | data_dir> --dedup
+    if (argc > 2 && std::string(argv[2]) == "--dedup")
+        return runDedupReport(path);
+    // klaipeda <file.ipf> --verify
+    if (argc > 2 && std::string(argv[2]) == "--verify")
+        return runVerify(path);
+
     IPFRoot root;
     if (!readIpfRootFromPath(path, root))
     {
@@ -51,3 +412,31 @@ int main()
     printHexViewer(data);
     return 0;
 }
+
+int main(int argc, char **argv)
+{
+    // klaipeda ... --trace <trace.json> works with every command of runCommand
+    std::vector<char *> args;
+    std::string tracePath;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+    if (tracePath.empty())
+        return runCommand(argc, argv);
+
+    setTracingEnabled(true);
+    int rc = runCommand(static_cast<int>(args.size()), args.data());
+    setTracingEnabled(false);
+
+    std::string err;
+    if (writeChromeTrace(tracePath, err))
+        logInfo("Wrote trace to " + tracePath);
+    else
+        logWarn(err);
+    std::cout << getTraceSummary();
+    return rc;
+}
@@ -1,9 +1,31 @@
 #include "thread_pool.hpp"
 
-ThreadPool::ThreadPool(size_t threads)
+#include <chrono>
+
+namespace
+{
+    // Which pool (if any) the calling thread works for, and its deque index.
+    thread_local ThreadPool *current_pool = nullptr;
+    thread_local size_t current_worker = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads, SchedulingMode schedulingMode) : mode(schedulingMode)
 {
+    if (mode == SchedulingMode::WorkStealing)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            local_queues.emplace_back(new WorkerQueue());
+    }
+
     for (size_t i = 0; i < threads; ++i)
     {
+        if (mode == SchedulingMode::WorkStealing)
+        {
+            workers.emplace_back([this, i]()
+                                 { runWorker(i); });
+            continue;
+        }
+
         workers.emplace_back([this]()
                              {
             for (;;) {
@@ -32,26 +54,186 @@ ThreadPool::~ThreadPool()
             w.join();
 }
 
-template <class F, class... Args>
-auto ThreadPool::enqueue(F &&f, Args &&...args)
-    -> std::future<typename std::result_of<F(Args...)>::type>
+void ThreadPool::submit(std::function<void()> &&task)
 {
-    using return_type = typename std::result_of<F(Args...)>::type;
-    auto task_ptr = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    if (mode == SchedulingMode::SharedQueue)
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            tasks.emplace(std::move(task));
+        }
+        condition.notify_one();
+        return;
+    }
 
-    std::future<return_type> res = task_ptr->get_future();
+    // Tasks spawned by a worker stay on its own deque; outside submissions are spread round-robin
+    size_t target = (current_pool == this) ? current_worker
+                                           : next_queue.fetch_add(1, std::memory_order_relaxed) % local_queues.size();
     {
+        // pending is raised before the push so it never drops below the real count
         std::unique_lock<std::mutex> lock(queue_mutex);
         if (stop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
-        tasks.emplace([task_ptr]()
-                      { (*task_ptr)(); });
+        pending.fetch_add(1);
+        std::lock_guard<std::mutex> queueLock(local_queues[target]->mutex);
+        local_queues[target]->tasks.push_back(std::move(task));
     }
     condition.notify_one();
-    return res;
 }
 
-// Explicit instantiation of the template for common signatures is not necessary here
-// but the file must compile; include the template in header as inline usually.
-// To keep it simple, define enqueue implementation in header in real projects.
+void ThreadPool::enqueueBatch(std::vector<std::function<void()>> &&batch)
+{
+    if (batch.empty())
+        return;
+
+    if (mode == SchedulingMode::SharedQueue)
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            for (auto &t : batch)
+                tasks.emplace(std::move(t));
+        }
+        condition.notify_all();
+        return;
+    }
+
+    // Deal tasks out like cards so every deque starts with the front (heaviest) of the batch
+    size_t queues = local_queues.size();
+    size_t first = next_queue.fetch_add(batch.size(), std::memory_order_relaxed);
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        pending.fetch_add(batch.size());
+        for (size_t q = 0; q < queues && q < batch.size(); ++q)
+        {
+            WorkerQueue &wq = *local_queues[(first + q) % queues];
+            std::lock_guard<std::mutex> queueLock(wq.mutex);
+            for (size_t i = q; i < batch.size(); i += queues)
+                wq.tasks.push_back(std::move(batch[i]));
+        }
+    }
+    condition.notify_all();
+}
+
+bool ThreadPool::popTask(size_t index, std::function<void()> &task)
+{
+    // Own deque from the front keeps submission order (largest first);
+    // thieves take from the back, where the small leftovers are.
+    size_t queues = local_queues.size();
+    for (size_t n = 0; n < queues; ++n)
+    {
+        WorkerQueue &wq = *local_queues[(index + n) % queues];
+        std::lock_guard<std::mutex> lock(wq.mutex);
+        if (wq.tasks.empty())
+            continue;
+        if (n == 0)
+        {
+            task = std::move(wq.tasks.front());
+            wq.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(wq.tasks.back());
+            wq.tasks.pop_back();
+        }
+        pending.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::runWorker(size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    for (;;)
+    {
+        std::function<void()> task;
+        if (popTask(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        condition.wait(lock, [this]
+                       { return stop || pending.load() > 0; });
+        if (stop && pending.load() == 0)
+            return;
+    }
+}
+
+bool ThreadPool::tryRunPendingTask()
+{
+    std::function<void()> task;
+    if (mode == SchedulingMode::WorkStealing)
+    {
+        if (!popTask(current_pool == this ? current_worker : 0, task))
+            return false;
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (tasks.empty())
+            return false;
+        task = std::move(tasks.front());
+        tasks.pop();
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::runRanges(const std::vector<std::pair<size_t, size_t>> &ranges, const std::function<void(size_t, size_t)> &body)
+{
+    if (ranges.empty())
+        return;
+
+    struct WaitState
+    {
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<WaitState>();
+    state->remaining = ranges.size();
+
+    std::vector<std::function<void()>> batch;
+    batch.reserve(ranges.size());
+    for (auto &r : ranges)
+    {
+        batch.emplace_back([state, &body, r]()
+                           {
+            try {
+                body(r.first, r.second);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error)
+                    state->error = std::current_exception();
+            }
+            if (state->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            } });
+    }
+    enqueueBatch(std::move(batch));
+
+    // Help instead of just blocking, so parallelFor nested inside a task cannot starve the pool
+    while (state->remaining.load() > 0)
+    {
+        if (tryRunPendingTask())
+            continue;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait_for(lock, std::chrono::milliseconds(1), [&state]
+                             { return state->remaining.load() == 0; });
+    }
+
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
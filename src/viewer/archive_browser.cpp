@@ -0,0 +1,254 @@
+#include "viewer/archive_browser.hpp"
+#include "ipf/utils.hpp"
+
+#include <imgui.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    // Filter work per frame; the rest continues next frame
+    const double FILTER_FRAME_BUDGET = 0.004;
+    const size_t FILTER_STEP_ROWS = 4096;
+
+    bool endsWithNoCase(const std::string &text, const char *suffix)
+    {
+        size_t n = std::strlen(suffix);
+        return text.size() >= n && equalsPathNoCase(StringRef(text.data() + text.size() - n, n), StringRef(suffix, n));
+    }
+
+    const void *rowId(uint32_t id, bool directory)
+    {
+        return reinterpret_cast<const void *>(static_cast<uintptr_t>(id) * 2 + (directory ? 1 : 0));
+    }
+}
+
+bool ArchiveBrowser::open(const std::string &path, const std::string &cachePath, std::vector<std::string> &warnings)
+{
+    bool mounted;
+    if (endsWithNoCase(path, ".ipf"))
+        mounted = fs.mountFiles(std::vector<std::string>{path}, warnings);
+    else if (!cachePath.empty())
+        mounted = fs.mountCached(path, cachePath, warnings);
+    else
+        mounted = fs.mount(path, warnings);
+    if (!mounted)
+        return false;
+
+    title = path;
+    tree.reset(&fs.getIndex(), &fs.getPaths());
+    filter.reset(&fs.getIndex(), &fs.getPaths());
+    extractor.reset(new ExtractionService(fs.getIndex()));
+    return true;
+}
+
+void ArchiveBrowser::draw()
+{
+    pollPreview();
+    advanceFilter();
+
+    ImGui::SetNextWindowSize(ImVec2(480, 720), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Archive"))
+    {
+        drawFilter();
+        if (filter.isActive())
+            drawMatches();
+        else
+            drawTree();
+    }
+    ImGui::End();
+
+    ImGui::SetNextWindowSize(ImVec2(720, 720), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Preview"))
+        drawPreview();
+    ImGui::End();
+}
+
+void ArchiveBrowser::drawFilter()
+{
+    ImGui::SetNextItemWidth(-1.0f);
+    if (ImGui::InputTextWithHint("##filter", "Filter: part of a path, or a glob such as *.ies", filter_text,
+                                 sizeof(filter_text)))
+        filter.setText(filter_text);
+
+    if (!filter.isActive())
+        ImGui::TextDisabled("%s: %zu files in %zu containers", title.c_str(), fs.size(), fs.getIndex().containerCount());
+    else if (!filter.isDone())
+        ImGui::TextDisabled("Searching... %d%%, %zu matches so far", static_cast<int>(filter.getProgress() * 100.0f),
+                            filter.getMatches().size());
+    else
+        ImGui::TextDisabled("%zu matches (double-click one to show it in the tree)", filter.getMatches().size());
+    ImGui::Separator();
+}
+
+void ArchiveBrowser::drawTree()
+{
+    ImGui::BeginChild("##tree");
+    if (scroll_to_selection)
+    {
+        // reveal left the selection's row in scroll_row
+        ImGui::SetScrollY(static_cast<float>(scroll_row) * ImGui::GetTextLineHeightWithSpacing() -
+                          ImGui::GetWindowHeight() * 0.5f);
+        scroll_to_selection = false;
+    }
+
+    // Rows are only read inside the clipper loop; a toggle changes them, so it waits until after
+    const size_t NO_TOGGLE = static_cast<size_t>(-1);
+    size_t toggled = NO_TOGGLE;
+    float indent = ImGui::GetStyle().IndentSpacing;
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(tree.getRowCount()));
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            const ArchiveTree::Row &row = tree.getRow(i);
+            StringRef name = tree.getName(i);
+            ImGui::SetCursorPosX(ImGui::GetCursorPosX() + static_cast<float>(row.depth) * indent);
+            ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanAvailWidth;
+            if (tree.isDirectory(i))
+            {
+                flags |= ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
+                ImGui::SetNextItemOpen(tree.isExpanded(i), ImGuiCond_Always);
+                ImGui::TreeNodeEx(rowId(row.node, true), flags, "%.*s", static_cast<int>(name.size), name.data);
+                if (ImGui::IsItemToggledOpen())
+                    toggled = static_cast<size_t>(i);
+            }
+            else
+            {
+                flags |= ImGuiTreeNodeFlags_Leaf;
+                if (has_selection && row.entry == selected_row)
+                    flags |= ImGuiTreeNodeFlags_Selected;
+                ImGui::TreeNodeEx(rowId(row.entry, false), flags, "%.*s", static_cast<int>(name.size), name.data);
+                if (ImGui::IsItemClicked())
+                    select(row.entry);
+            }
+        }
+    }
+    if (toggled != NO_TOGGLE)
+        tree.toggle(toggled);
+    ImGui::EndChild();
+}
+
+void ArchiveBrowser::drawMatches()
+{
+    ImGui::BeginChild("##matches");
+    const std::vector<uint32_t> &matches = filter.getMatches();
+    bool revealed = false;
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(matches.size()));
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+        {
+            uint32_t row = matches[i];
+            StringRef path = fs.getIndex().getEntry(row).getDirectoryName();
+            ImGui::PushID(i);
+            if (ImGui::Selectable("##match", has_selection && row == selected_row))
+                select(row);
+            if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+                revealed = true;
+            ImGui::SameLine(0.0f, 0.0f);
+            ImGui::TextUnformatted(path.begin(), path.end());
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+
+    // Drop the filter and show the selection in place
+    if (revealed && has_selection)
+    {
+        filter_text[0] = '\0';
+        filter.setText(std::string());
+        scroll_to_selection = tree.reveal(fs.getIndex().getEntry(selected_row).getDirectoryName(), scroll_row);
+    }
+}
+
+void ArchiveBrowser::drawPreview()
+{
+    if (!has_selection)
+    {
+        ImGui::TextDisabled("Select a file to preview it");
+        return;
+    }
+
+    IPFEntryView ent = fs.getIndex().getEntry(selected_row);
+    StringRef path = ent.getDirectoryName();
+    ImGui::TextUnformatted(path.begin(), path.end());
+    ImGui::TextDisabled("%s, %u bytes (%u stored)", ent.getFilePath().c_str(), ent.getFileSizeUncompressed(),
+                        ent.getFileSizeCompressed());
+    ImGui::Separator();
+
+    if (!preview_error.empty())
+    {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", preview_error.c_str());
+        return;
+    }
+    if (!preview_data)
+    {
+        ImGui::TextDisabled("Extracting...");
+        return;
+    }
+
+    // Only the lines on screen are formatted, whatever the entry size
+    ImGui::BeginChild("##hex", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+    ByteSpan data(preview_data->data(), preview_data->size());
+    HexFormatter formatter(data.size);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(HexFormatter::getLineCount(data.size)));
+    while (clipper.Step())
+    {
+        hex_lines.clear();
+        formatter.formatLines(data, 0, static_cast<uint64_t>(clipper.DisplayStart),
+                              static_cast<size_t>(clipper.DisplayEnd - clipper.DisplayStart), hex_lines);
+        const char *line = hex_lines.data();
+        const char *end = line + hex_lines.size();
+        while (line < end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+            ImGui::TextUnformatted(line, newline);
+            line = newline + 1;
+        }
+    }
+    ImGui::EndChild();
+}
+
+void ArchiveBrowser::select(uint32_t row)
+{
+    if (has_selection && row == selected_row)
+        return;
+    has_selection = true;
+    selected_row = row;
+
+    // The previous selection is of no interest any more, wherever it got to,
+    // and neither are the neighbours prefetched for it
+    preview_token.cancel();
+    extractor->cancelPrefetches();
+    preview_token = CancellationToken();
+    preview_data.reset();
+    preview_error.clear();
+    preview_request = extractor->submit(row, ExtractPriority::Interactive, preview_token);
+}
+
+void ArchiveBrowser::pollPreview()
+{
+    if (!preview_request.valid() || preview_request.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    ExtractResult result = preview_request.get();
+    if (result.cancelled || result.row != selected_row)
+        return;
+    if (result.ok)
+        preview_data = result.data;
+    else
+        preview_error = result.error;
+}
+
+void ArchiveBrowser::advanceFilter()
+{
+    auto start = std::chrono::steady_clock::now();
+    while (!filter.step(FILTER_STEP_ROWS) &&
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < FILTER_FRAME_BUDGET)
+    {
+    }
+}